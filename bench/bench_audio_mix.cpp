@@ -0,0 +1,193 @@
+// Mixes many looping voices a callback's worth at a time, the way audio_system's callback used to
+// (sample by sample into the shorts, clamping every add and checking for the end of the buffer
+// every sample) and the way it does now (whole spans into a float bus, one limited conversion at
+// the end). Reports voices mixed per millisecond of CPU time. First checks the kernels against
+// plain loops, at every length up to a few vectors and from misaligned starts.
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <print>
+#include <vector>
+
+#include "audio_mix.hpp"
+#include "bench_util.hpp"
+#include "random.hpp"
+
+constexpr size_t VOICES = 64;
+constexpr size_t CALLBACK_SAMPLES = 256; // 128 stereo frames
+constexpr int CALLBACKS = 20000;
+
+struct bench_voice
+{
+    const std::vector<short>* samples;
+    size_t cursor;
+    float volume;
+};
+
+// what the kernels have to agree with; bus_to_s16 may round the ramped gain differently by a step
+static bool check_kernels(rng_stream& rng)
+{
+    constexpr size_t MAX_LENGTH = 40;
+    constexpr size_t MAX_OFFSET = 8;
+
+    std::vector<short> src(MAX_LENGTH + MAX_OFFSET);
+    std::vector<float> bus(MAX_LENGTH + MAX_OFFSET);
+    std::vector<float> expected(MAX_LENGTH + MAX_OFFSET);
+    std::vector<short> out(MAX_LENGTH + MAX_OFFSET);
+
+    for (size_t offset = 0; offset < MAX_OFFSET; ++offset)
+    {
+        for (size_t n = 0; n <= MAX_LENGTH; ++n)
+        {
+            for (size_t i = 0; i < src.size(); ++i)
+            {
+                src[i] = static_cast<short>(rng.rand_int(SHRT_MIN, SHRT_MAX));
+                bus[i] = expected[i] = rng.rand_real(-70000.f, 70000.f);
+            }
+
+            const float volume = rng.rand_real(0.f, 1.f);
+            mix_span(bus.data() + offset, src.data() + offset, n, volume);
+            for (size_t i = 0; i < n; ++i)
+            {
+                expected[offset + i] += static_cast<float>(src[offset + i]) * volume;
+            }
+            for (size_t i = 0; i < bus.size(); ++i)
+            {
+                if (std::abs(bus[i] - expected[i]) > std::abs(expected[i]) * 1e-6f)
+                {
+                    std::println("mix_span: length {} offset {} differs at {}", n, offset, i);
+                    return false;
+                }
+            }
+
+            float peak = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                peak = std::max(peak, std::abs(bus[offset + i]));
+            }
+            if (bus_peak(bus.data() + offset, n) != peak)
+            {
+                std::println("bus_peak: length {} offset {} differs", n, offset);
+                return false;
+            }
+
+            const float gain_from = rng.rand_real(0.f, 1.f);
+            const float gain_to = rng.rand_real(0.f, 1.f);
+            std::fill(out.begin(), out.end(), short(0));
+            bus_to_s16(out.data() + offset, bus.data() + offset, n, gain_from, gain_to);
+            for (size_t i = 0; i < out.size(); ++i)
+            {
+                long want = 0;
+                if (i >= offset && i < offset + n)
+                {
+                    const double gain = gain_from + (gain_to - gain_from) * static_cast<double>(i - offset) / static_cast<double>(n);
+                    want = std::clamp(std::lround(bus[i] * gain), long(SHRT_MIN), long(SHRT_MAX));
+                }
+                if (std::abs(out[i] - want) > 1)
+                {
+                    std::println("bus_to_s16: length {} offset {} differs at {}", n, offset, i);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static void mix_per_sample(std::vector<bench_voice>& voices, short* out)
+{
+    std::fill_n(out, CALLBACK_SAMPLES, short(0));
+    for (bench_voice& v : voices)
+    {
+        short* data = out;
+        for (size_t s = 0; s < CALLBACK_SAMPLES; ++s)
+        {
+            *data = static_cast<short>(std::clamp<int>(*data + static_cast<short>((*v.samples)[v.cursor] * v.volume), SHRT_MIN, SHRT_MAX));
+            ++data;
+            ++v.cursor;
+            if (v.cursor == v.samples->size())
+            {
+                v.cursor = 0;
+            }
+        }
+    }
+}
+
+static void mix_spans(std::vector<bench_voice>& voices, float* bus, audio_limiter& limiter, short* out)
+{
+    std::fill_n(bus, CALLBACK_SAMPLES, 0.f);
+    for (bench_voice& v : voices)
+    {
+        for (size_t mixed = 0; mixed < CALLBACK_SAMPLES;)
+        {
+            const size_t n = std::min(CALLBACK_SAMPLES - mixed, v.samples->size() - v.cursor);
+            mix_span(bus + mixed, v.samples->data() + v.cursor, n, v.volume);
+            mixed += n;
+            v.cursor += n;
+            if (v.cursor == v.samples->size())
+            {
+                v.cursor = 0;
+            }
+        }
+    }
+    limiter.process(out, bus, CALLBACK_SAMPLES);
+}
+
+int main()
+{
+    rng_stream rng(1);
+
+    if (!check_kernels(rng))
+    {
+        return EXIT_FAILURE;
+    }
+    std::println("kernels match plain loops");
+
+    // a few short sounds of odd lengths so voices loop at all sorts of places
+    std::vector<std::vector<short>> sounds;
+    for (size_t len : {4410u, 7351u, 22050u, 1999u})
+    {
+        std::vector<short>& s = sounds.emplace_back(2 * len);
+        for (short& x : s)
+        {
+            x = static_cast<short>(rng.rand_int(-12000, 12000));
+        }
+    }
+
+    std::vector<bench_voice> voices;
+    for (size_t i = 0; i < VOICES; ++i)
+    {
+        const auto& s = sounds[i % sounds.size()];
+        voices.push_back({&s, static_cast<size_t>(rng.rand_int(0, static_cast<int>(s.size() / 2) - 1)) * 2, rng.rand_real(0.2f, 1.f)});
+    }
+    std::vector<bench_voice> span_voices = voices;
+
+    std::vector<short> out(CALLBACK_SAMPLES);
+    std::vector<float> bus(CALLBACK_SAMPLES);
+    audio_limiter limiter;
+
+    uint64_t checksum = 0;
+    const double per_sample_ms = time_ms([&] {
+        for (int c = 0; c < CALLBACKS; ++c)
+        {
+            mix_per_sample(voices, out.data());
+            checksum += static_cast<uint16_t>(out[c % CALLBACK_SAMPLES]);
+        }
+    });
+    const double spans_ms = time_ms([&] {
+        for (int c = 0; c < CALLBACKS; ++c)
+        {
+            mix_spans(span_voices, bus.data(), limiter, out.data());
+            checksum += static_cast<uint16_t>(out[c % CALLBACK_SAMPLES]);
+        }
+    });
+
+    const double voice_callbacks = static_cast<double>(VOICES) * CALLBACKS;
+    std::println("{} voices, {} samples per callback, {} callbacks (checksum {})", VOICES, CALLBACK_SAMPLES, CALLBACKS, checksum);
+    std::println("per sample, clamping into shorts: {:.0f} voices/ms", voice_callbacks / per_sample_ms);
+    std::println("spans into a float bus:           {:.0f} voices/ms", voice_callbacks / spans_ms);
+    std::println("limiter gain at the end: {:.3f}", limiter.gain);
+}
@@ -0,0 +1,145 @@
+// A battle far bigger than any encounter: hundreds of enemies, each casting ragworm_burst over and
+// over, while the player keeps thousands of piercing knives in the air. Times battle_field::update
+// and then, on the final state, the projectile-vs-character tests alone, once through the
+// broadphase and once by testing every pair like battle_field used to.
+
+#include <print>
+#include <vector>
+
+#include "battle/battle_field.hpp"
+#include "battle/skill.hpp"
+#include "bench_util.hpp"
+#include "random.hpp"
+
+constexpr size_t ENEMY_COUNT = 400;
+constexpr size_t PLAYER_KNIVES = 3000;
+constexpr int FRAMES = 300;
+constexpr int CAST_PERIOD = 40;
+constexpr int PAIR_ROUNDS = 20;
+
+static size_t player_knives(const battle_field& field)
+{
+    size_t count = 0;
+    for (const battle_projectile& p : field.projectiles)
+    {
+        count += p.owner == field.character_handle(field.player_index);
+    }
+    return count;
+}
+
+static void spawn_player_knife(battle_field& field)
+{
+    battle_projectile& p = field.spawn_projectile(24);
+    p.prev_pos = p.pos = {field.rng.rand_real(field.bounds.left, field.bounds.right), field.rng.rand_real(field.bounds.floor, field.bounds.floor + 64)};
+    p.vel = {field.rng.rand_real(-3, 3), field.rng.rand_real(-0.2f, 0.2f)};
+    p.owner = field.character_handle(field.player_index);
+    p.angle_to_velocity = true;
+    // keeps flying through everything it meets
+    p.pierce = UINT32_MAX / 2;
+}
+
+// the old loop: every projectile against every character it's allowed to hit
+static size_t brute_force_pairs(battle_field& field)
+{
+    size_t pairs = 0;
+    for (const battle_projectile& p : field.projectiles)
+    {
+        rectangle proj_rect = p.worldspace_hitbox();
+        rectangle unused;
+        bool is_monster_owned = p.owner.index != field.player_index;
+        for (size_t i = 0; i < field.characters.size(); ++i)
+        {
+            if ((i == field.player_index) != is_monster_owned)
+            {
+                continue;
+            }
+            pairs += proj_rect.intersect(field.characters[i].worldspace_hitbox(), unused);
+        }
+    }
+    return pairs;
+}
+
+static size_t broadphase_pairs(battle_field& field)
+{
+    size_t pairs = 0;
+    field.enemy_broadphase.build(field.characters, field.player_index);
+    rectangle player_rect = field.player().worldspace_hitbox();
+    for (const battle_projectile& p : field.projectiles)
+    {
+        rectangle proj_rect = p.worldspace_hitbox();
+        rectangle unused;
+        if (p.owner.index != field.player_index)
+        {
+            pairs += proj_rect.intersect(player_rect, unused);
+            continue;
+        }
+
+        field.enemy_broadphase.query(proj_rect, field.hit_candidates);
+        for (size_t i : field.hit_candidates)
+        {
+            pairs += proj_rect.intersect(field.characters[i].worldspace_hitbox(), unused);
+        }
+    }
+    return pairs;
+}
+
+int main()
+{
+    battle_field field;
+    field.bounds = {-2000, 2000, 0};
+    field.spawn_character(BCI_PLAYER, {0, 0});
+    field.set_player_index(0);
+    for (size_t i = 0; i < ENEMY_COUNT; ++i)
+    {
+        field.spawn_character(BCI_RAGWORM, {field.rng.rand_real(field.bounds.left, field.bounds.right), 0});
+    }
+    field.init_positions();
+
+    std::vector<ragworm_burst> bursts(field.characters.size());
+
+    size_t peak_projectiles = 0;
+    double update_ms = time_ms([&] {
+        for (int f = 0; f < FRAMES; ++f)
+        {
+            for (size_t i = 1; i < field.characters.size(); ++i)
+            {
+                battle_character& c = field.characters[i];
+                // nobody dies, so the crowd stays the same size
+                c.life = c.info->max_life;
+                c.alive = true;
+                if (static_cast<int>(i % CAST_PERIOD) == f % CAST_PERIOD)
+                {
+                    bursts[i].use(field, c);
+                }
+                bursts[i].update(field, c);
+            }
+
+            for (size_t n = player_knives(field); n < PLAYER_KNIVES; ++n)
+            {
+                spawn_player_knife(field);
+            }
+
+            field.update(true);
+            peak_projectiles = std::max(peak_projectiles, field.projectiles.size());
+        }
+    });
+
+    size_t brute_pairs = 0, broad_pairs = 0;
+    double brute_ms = time_ms([&] {
+        for (int r = 0; r < PAIR_ROUNDS; ++r)
+        {
+            brute_pairs = brute_force_pairs(field);
+        }
+    });
+    double broad_ms = time_ms([&] {
+        for (int r = 0; r < PAIR_ROUNDS; ++r)
+        {
+            broad_pairs = broadphase_pairs(field);
+        }
+    });
+
+    std::println("{} characters, {} projectiles at peak, {} frames", field.characters.size(), peak_projectiles, FRAMES);
+    std::println("battle_field::update: {:.3f} ms/frame", update_ms / FRAMES);
+    std::println("pair tests, every pair: {:.3f} ms ({} hits)", brute_ms / PAIR_ROUNDS, brute_pairs);
+    std::println("pair tests, broadphase: {:.3f} ms ({} hits)", broad_ms / PAIR_ROUNDS, broad_pairs);
+}
@@ -0,0 +1,93 @@
+// Saves a busy horde battle partway through, plays it on while recording a digest every tick, then
+// restores the snapshot and plays the same ticks again, checking the digests agree. Then times
+// saving and restoring on their own, and compares the size of the snapshot with a small battle's.
+
+#include <cstdlib>
+#include <print>
+#include <vector>
+
+#include "battle/battle_snapshot.hpp"
+#include "battle/encounters.hpp"
+#include "bench_util.hpp"
+
+constexpr uint32_t HORDE_SIZE = 1024;
+constexpr int WARMUP_TICKS = 150;
+constexpr int REPLAY_TICKS = 300;
+constexpr int ROUNDS = 200;
+
+// the player throws everything as often as they can and can't die, so the battle stays busy
+static void tick(battle_field& field, player_kit& kit)
+{
+    field.player().life = field.player().info->max_life;
+    if (field.player().can_act())
+    {
+        kit.throw_knives(field);
+        kit.throw_avenger(field);
+    }
+    field.update(false);
+    kit.update(field);
+}
+
+int main()
+{
+    battle_field field;
+    field.begin(get_horde_encounter(HORDE_SIZE), {-1000, 1000, 0}, 1);
+
+    player_kit kit;
+    kit.has_avenger = true;
+    kit.has_shadowpartner = true;
+
+    for (int t = 0; t < WARMUP_TICKS; ++t)
+    {
+        tick(field, kit);
+    }
+
+    battle_snapshot snapshot;
+    field.save_snapshot(snapshot);
+    const player_kit saved_kit = kit;
+
+    std::vector<uint64_t> digests;
+    for (int t = 0; t < REPLAY_TICKS; ++t)
+    {
+        tick(field, kit);
+        digests.push_back(battle_digest(field));
+    }
+
+    field.restore_snapshot(snapshot);
+    kit = saved_kit;
+    for (int t = 0; t < REPLAY_TICKS; ++t)
+    {
+        tick(field, kit);
+        if (battle_digest(field) != digests[t])
+        {
+            std::println("replay diverged {} ticks after the snapshot", t + 1);
+            return EXIT_FAILURE;
+        }
+    }
+
+    field.save_snapshot(snapshot);
+    const double save_us = time_us([&] {
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            field.save_snapshot(snapshot);
+        }
+    });
+    const double restore_us = time_us([&] {
+        for (int r = 0; r < ROUNDS; ++r)
+        {
+            field.restore_snapshot(snapshot);
+        }
+    });
+
+    std::println("{} characters, {} projectiles, {} particles, {} effects", field.characters.size(), field.projectiles.size(), field.particle_sys.particles.size(), field.fx_sys.effects.size());
+    std::println("replayed {} ticks from the snapshot identically", REPLAY_TICKS);
+    std::println("save_snapshot: {:.2f} us", save_us / ROUNDS);
+    std::println("restore_snapshot: {:.2f} us", restore_us / ROUNDS);
+
+    // snapshots only hold what's alive, so a small battle's is small
+    battle_field small;
+    small.begin(get_horde_encounter(3), {-1000, 1000, 0}, 1);
+    battle_snapshot small_snapshot;
+    small.save_snapshot(small_snapshot);
+    std::println("snapshot size: {} bytes for this battle, {} bytes for {} characters", snapshot.memory_usage(), small_snapshot.memory_usage(), small.characters.size());
+}
@@ -0,0 +1,169 @@
+// Updates 50k overworld entities per frame, once through entity_storage and once through a copy
+// of the old array-of-structs layout for comparison. entity_storage runs twice: with the whole map
+// in range, and with only a screen around one corner in range.
+
+#include <chrono>
+#include <climits>
+#include <print>
+#include <string>
+#include <vector>
+
+#include "world.hpp"
+
+constexpr size_t ENTITY_COUNT = 50'000;
+constexpr int FRAMES = 600;
+
+// the entity layout before the hot/cold split, trimmed to what its update touched
+struct fat_entity
+{
+    std::string name;
+    move_state mstate = IDLE;
+    direction face = down;
+    uint32_t world_x = 0, world_y = 0;
+    uint32_t prev_world_x = 0, prev_world_y = 0;
+    uint32_t move_speed = 4;
+    uint32_t interact_script = entity::INVALID_SCRIPT;
+    uint32_t sprite_id = entity::INVALID_SPRITE;
+    entity_type type = none;
+    bool open = false;
+    portal portal_state;
+    light light_state;
+    e_switch switch_state;
+    bool active = true;
+    const animation_set* aset = nullptr;
+    animator anim;
+
+    void begin_move(direction f)
+    {
+        if (mstate != IDLE)
+            return;
+
+        switch (f)
+        {
+        case down:
+            mstate = MOVE_DOWN;
+            break;
+        case left:
+            mstate = MOVE_LEFT;
+            break;
+        case right:
+            mstate = MOVE_RIGHT;
+            break;
+        case up:
+            mstate = MOVE_UP;
+            break;
+        }
+    }
+
+    void update()
+    {
+        prev_world_x = world_x;
+        prev_world_y = world_y;
+
+        if (mstate == MOVE_LEFT)
+            world_x -= move_speed;
+        if (mstate == MOVE_RIGHT)
+            world_x += move_speed;
+        if (mstate == MOVE_UP)
+            world_y -= move_speed;
+        if (mstate == MOVE_DOWN)
+            world_y += move_speed;
+
+        if ((mstate == MOVE_LEFT || mstate == MOVE_RIGHT) && world_x % 16 == 0)
+            mstate = IDLE;
+        if ((mstate == MOVE_UP || mstate == MOVE_DOWN) && world_y % 16 == 0)
+            mstate = IDLE;
+
+        if (sprite_id != entity::INVALID_SPRITE)
+            anim.update();
+    }
+};
+
+static direction pick_direction(size_t i, int frame)
+{
+    return static_cast<direction>((i * 7 + frame / 16) % 4);
+}
+
+template <typename F>
+static double time_frames(F&& frame)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < FRAMES; ++f)
+    {
+        frame(f);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / FRAMES;
+}
+
+int main()
+{
+    // every other entity is a walking npc, the rest are doors and torches
+    entity_storage store;
+    store.reserve(ENTITY_COUNT);
+    std::vector<fat_entity> fat(ENTITY_COUNT);
+    for (size_t i = 0; i < ENTITY_COUNT; ++i)
+    {
+        uint32_t x = static_cast<uint32_t>(1024 + (i % 1000) * 16);
+        uint32_t y = static_cast<uint32_t>(1024 + (i / 1000) * 16);
+        entity_type type = i % 2 ? npc : i % 4 ? door : et_light;
+        uint32_t sprite = type == npc ? 0 : type == door ? 8 : 10;
+
+        entity& e = store.add();
+        e.name = std::format("entity_{}", i);
+        e.set_type(type);
+        e.set_world_position(x, y);
+        e.set_sprite_id(sprite);
+
+        fat_entity& fe = fat[i];
+        fe.name = e.name;
+        fe.type = type;
+        fe.world_x = fe.prev_world_x = x;
+        fe.world_y = fe.prev_world_y = y;
+        fe.sprite_id = e.sprite_id;
+        fe.aset = e.aset;
+        fe.anim = e.anim();
+    }
+
+    auto soa_frames = [&](const rectangle& near_area) {
+        return time_frames([&](int f) {
+            update_animation_clocks(f);
+            if (f % 4 == 0)
+            {
+                for (size_t i = 1; i < store.size(); i += 2)
+                {
+                    store[i].begin_move(pick_direction(i, f));
+                }
+            }
+            store.update(near_area);
+        });
+    };
+
+    const rectangle everywhere{0, 0, INT_MAX, INT_MAX};
+    double soa_ms = soa_frames(everywhere);
+    const activity_stats soa_activity = store.activity;
+
+    const int r = static_cast<int>(world::DEFAULT_LOD_RADIUS);
+    const rectangle screen{1024 - r, 1024 - r, 512 + 2 * r, 256 + 2 * r};
+    double lod_ms = soa_frames(screen);
+    const activity_stats lod_activity = store.activity;
+
+    double aos_ms = time_frames([&](int f) {
+        if (f % 4 == 0)
+        {
+            for (size_t i = 1; i < fat.size(); i += 2)
+            {
+                fat[i].begin_move(pick_direction(i, f));
+            }
+        }
+        for (fat_entity& e : fat)
+        {
+            e.update();
+        }
+    });
+
+    std::println("{} entities, {} frames", ENTITY_COUNT, FRAMES);
+    std::println("entity_storage: {:.3f} ms/frame ({} active, {} sleeping)", soa_ms, soa_activity.active, soa_activity.sleeping);
+    std::println("entity_storage, one screen near: {:.3f} ms/frame ({} active, {} sleeping, {} lod)", lod_ms, lod_activity.active, lod_activity.sleeping, lod_activity.lod);
+    std::println("array of structs: {:.3f} ms/frame", aos_ms);
+}
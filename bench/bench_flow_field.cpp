@@ -0,0 +1,149 @@
+// Walks a target around a 256x256 dungeon with a few one-way tiles, repairing a flow_field after
+// every step, and checks it against pathfinder: every tile near the target has to get the same
+// distance A* finds, and following the field from it has to arrive in that many steps. Then times
+// repairing against rebuilding the field from scratch after each step.
+
+#include <cstdlib>
+#include <print>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bench_maps.hpp"
+#include "bench_util.hpp"
+#include "flow_field.hpp"
+#include "pathfinding.hpp"
+
+constexpr uint32_t MAP_SIZE = 256;
+constexpr int WALK_STEPS = 2000;
+constexpr int CHECK_EVERY = 50;
+
+// moves the target one step it's allowed to take
+static void walk(const tilemap& map, std::mt19937& rng, uint32_t& x, uint32_t& y)
+{
+    constexpr int DX[] = {1, 0, -1, 0};
+    constexpr int DY[] = {0, -1, 0, 1};
+
+    const uint8_t exits = tile_exits(map, x, y);
+    for (;;)
+    {
+        const int d = static_cast<int>(rng() % 4);
+        if (exits & (1 << d))
+        {
+            x += DX[d];
+            y += DY[d];
+            return;
+        }
+    }
+}
+
+static bool check(const flow_field& flow, pathfinder& paths, uint32_t target_x, uint32_t target_y)
+{
+    constexpr int DX[] = {1, 0, -1, 0};
+    constexpr int DY[] = {0, -1, 0, 1};
+    constexpr uint32_t R = flow_field::DEFAULT_RADIUS;
+
+    std::vector<direction> steps;
+    for (uint32_t y = target_y > R ? target_y - R : 0; y <= target_y + R && y < MAP_SIZE; ++y)
+    {
+        for (uint32_t x = target_x > R ? target_x - R : 0; x <= target_x + R && x < MAP_SIZE; ++x)
+        {
+            steps.clear();
+            const uint32_t expected = paths.find_path(x, y, target_x, target_y, steps) ? static_cast<uint32_t>(steps.size()) : flow_field::UNREACHED;
+            const uint32_t got = flow.distance(x, y);
+
+            // the field only sees its window, which holds every path up to the radius long
+            if (std::min(expected, got) > R)
+            {
+                continue;
+            }
+
+            if (expected != got)
+            {
+                std::println("{},{} is {} steps from the target at {},{} but the field says {}", x, y, expected, target_x, target_y, got);
+                return false;
+            }
+
+            uint32_t fx = x, fy = y, followed = 0;
+            direction d;
+            while (flow.step_towards(fx, fy, d) && followed <= got)
+            {
+                fx += DX[d];
+                fy += DY[d];
+                ++followed;
+            }
+            if (fx != target_x || fy != target_y || followed != got)
+            {
+                std::println("following the field from {},{} took {} steps and stopped at {},{}", x, y, followed, fx, fy);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool run(const char* label, const tilemap& map, std::mt19937& rng)
+{
+    pathfinder paths;
+    paths.attach(map);
+
+    uint32_t x = 0, y = 0;
+    do
+    {
+        x = rng() % MAP_SIZE;
+        y = rng() % MAP_SIZE;
+    } while (tile_exits(map, x, y) == TILE_BLOCKED || tile_exits(map, x, y) == 0);
+
+    flow_field repaired;
+    repaired.attach(map);
+    repaired.set_target(x, y);
+    repaired.update(UINT32_MAX);
+
+    std::vector<std::pair<uint32_t, uint32_t>> trail;
+    uint64_t repaired_tiles = 0;
+    int repairs = 0;
+    double repair_ms = 0;
+    for (int s = 1; s <= WALK_STEPS; ++s)
+    {
+        walk(map, rng, x, y);
+        trail.push_back({x, y});
+        repaired.set_target(x, y);
+        repair_ms += time_ms([&] { repaired.update(UINT32_MAX); });
+        repaired_tiles += repaired.last_build_tiles();
+        repairs += repaired.last_build_repaired();
+
+        if (s % CHECK_EVERY == 0 && !check(repaired, paths, x, y))
+        {
+            return false;
+        }
+    }
+
+    // the same walk, starting over every time
+    flow_field rebuilt;
+    uint64_t rebuilt_tiles = 0;
+    double rebuild_ms = 0;
+    for (auto [tx, ty] : trail)
+    {
+        rebuild_ms += time_ms([&] {
+            rebuilt.attach(map);
+            rebuilt.set_target(tx, ty);
+            rebuilt.update(UINT32_MAX);
+        });
+        rebuilt_tiles += rebuilt.last_build_tiles();
+    }
+
+    std::println("{}:", label);
+    std::println("  {} of {} steps repaired, every {} checked against A*", repairs, WALK_STEPS, CHECK_EVERY);
+    std::println("  repaired: {:.1f} us and {} tiles per step", repair_ms * 1000 / WALK_STEPS, repaired_tiles / WALK_STEPS);
+    std::println("  rebuilt:  {:.1f} us and {} tiles per step", rebuild_ms * 1000 / WALK_STEPS, rebuilt_tiles / WALK_STEPS);
+    return true;
+}
+
+int main()
+{
+    std::mt19937 rng(1234);
+    if (!run("open dungeon", make_dungeon(rng, MAP_SIZE, 0), rng) || !run("dungeon with one-way tiles", make_dungeon(rng, MAP_SIZE, 20), rng))
+    {
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "tilemap.hpp"
+
+// size x size rooms joined by corridors, the rest solid wall. the last one_way_tiles room centers
+// get a tile that can only be left one way, which turns jump point search off.
+inline tilemap make_dungeon(std::mt19937& rng, uint32_t size, uint32_t one_way_tiles)
+{
+    constexpr uint32_t WALL = 0, FLOOR = 500, ONE_WAY = 128;
+    std::vector<tile> base(size * size, tile{WALL});
+    auto carve = [&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) {
+        for (uint32_t y = std::min(y0, y1); y <= std::max(y0, y1); ++y)
+            for (uint32_t x = std::min(x0, x1); x <= std::max(x0, x1); ++x)
+                base[y * size + x].id = FLOOR;
+    };
+
+    std::vector<uint32_t> centers;
+    uint32_t prev_x = size / 2, prev_y = size / 2;
+    for (int room = 0; room < 120; ++room)
+    {
+        uint32_t w = 4 + rng() % 16, h = 4 + rng() % 12;
+        uint32_t x = 1 + rng() % (size - w - 2), y = 1 + rng() % (size - h - 2);
+        carve(x, y, x + w, y + h);
+        uint32_t cx = x + w / 2, cy = y + h / 2;
+        carve(prev_x, prev_y, cx, prev_y);
+        carve(cx, prev_y, cx, cy);
+        prev_x = cx;
+        prev_y = cy;
+        centers.push_back(cy * size + cx);
+    }
+
+    for (uint32_t i = 0; i < one_way_tiles && i < centers.size(); ++i)
+    {
+        base[centers[centers.size() - 1 - i]].id = ONE_WAY;
+    }
+
+    std::vector<tile> detail(size * size, tile{FLOOR});
+    return {size, size, tile_layer(std::move(base), size), tile_layer(std::move(detail), size), tile_layer(std::vector<tile>(size * size), size)};
+}
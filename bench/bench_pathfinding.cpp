@@ -0,0 +1,188 @@
+// Runs the same batch of random queries on a 256x256 dungeon through pathfinder (jump point
+// search on an open grid, A* once a one-way tile turns that off) and through a copy of the old
+// unordered_map based A* for comparison.
+
+#include <algorithm>
+#include <climits>
+#include <deque>
+#include <print>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "bench_maps.hpp"
+#include "bench_util.hpp"
+#include "mathutil.hpp"
+#include "pathfinding.hpp"
+
+constexpr uint32_t MAP_SIZE = 256;
+constexpr size_t QUERY_COUNT = 200;
+
+// the old implementation, with the collision checks it was missing so both solve the same problem
+namespace old
+{
+struct point
+{
+    int x, y;
+    bool operator==(const point& rhs) const
+    {
+        return x == rhs.x && y == rhs.y;
+    }
+    point left() const { return {x - 1, y}; }
+    point right() const { return {x + 1, y}; }
+    point up() const { return {x, y - 1}; }
+    point down() const { return {x, y + 1}; }
+};
+
+struct point_hash
+{
+    size_t operator()(const point& p) const
+    {
+        return p.x + (p.y << 16);
+    }
+};
+
+struct score_map : private std::unordered_map<point, int, point_hash>
+{
+    int get(const point& p)
+    {
+        if (auto it = find(p); it != end())
+        {
+            return it->second;
+        }
+        else
+        {
+            return INT_MAX - 10000;
+        }
+    }
+
+    void set(const point& p, int val)
+    {
+        operator[](p) = val;
+    }
+};
+
+using path_map = std::unordered_map<point, point, point_hash>;
+using path_seq = std::deque<point>;
+
+inline path_seq reconstruct_path(const path_map& came_from, point current)
+{
+    path_seq total_path{current};
+    path_map::const_iterator it;
+    for (;;)
+    {
+        it = came_from.find(current);
+        if (it == came_from.end())
+            break;
+        current = it->second;
+        total_path.push_front(current);
+    }
+    return total_path;
+}
+
+inline path_seq find_path(const tilemap& map, int x0, int y0, int x1, int y1)
+{
+    point start{x0, y0};
+    point end{x1, y1};
+
+    std::unordered_set<point, point_hash> frontier_set;
+    std::vector<point> frontier;
+    frontier.push_back(start);
+
+    path_map came_from;
+    score_map g_score;
+    g_score.set(start, 0);
+    score_map f_score;
+    f_score.set(start, 0);
+
+    auto check_adjacent_point = [&](const point& from, const point& to, direction d) {
+        if (!map.valid(to.x, to.y) || map.collides_from(to.x, to.y, invert(d)) || !map.can_move_from(from.x, from.y, d))
+        {
+            return;
+        }
+
+        int tentative_g_score = g_score.get(from) + 1;
+        if (tentative_g_score < g_score.get(to))
+        {
+            came_from[to] = from;
+            g_score.set(to, tentative_g_score);
+            f_score.set(to, tentative_g_score + manhattan(to.x, to.y, end.x, end.y));
+
+            if (!frontier_set.count(to))
+            {
+                frontier.push_back(to);
+                frontier_set.insert(to);
+                std::push_heap(frontier.begin(), frontier.end(), [&](const point& left, const point& right) {
+                    return f_score.get(left) > f_score.get(right);
+                });
+            }
+        }
+    };
+
+    while (frontier.size())
+    {
+        point current = frontier.front();
+        std::pop_heap(frontier.begin(), frontier.end(), [&](const point& left, const point& right) {
+            return f_score.get(left) > f_score.get(right);
+        });
+        frontier.pop_back();
+
+        if (current == end)
+        {
+            return reconstruct_path(came_from, current);
+        }
+
+        check_adjacent_point(current, current.left(), left);
+        check_adjacent_point(current, current.right(), right);
+        check_adjacent_point(current, current.up(), up);
+        check_adjacent_point(current, current.down(), down);
+    }
+
+    return {};
+}
+} // namespace old
+
+static void run(const char* label, const tilemap& map, std::mt19937& rng)
+{
+    pathfinder pf;
+    double attach_ms = time_ms([&]() { pf.attach(map); });
+
+    // only queries that have an answer, the old code gives up badly otherwise
+    std::vector<path_request> requests;
+    std::vector<direction> scratch;
+    std::uniform_int_distribution<uint32_t> coord(0, MAP_SIZE - 1);
+    while (requests.size() < QUERY_COUNT)
+    {
+        path_request r{coord(rng), coord(rng), coord(rng), coord(rng)};
+        scratch.clear();
+        if (pf.find_path(r.from_x, r.from_y, r.to_x, r.to_y, scratch) && scratch.size() > 32)
+        {
+            requests.push_back(r);
+        }
+    }
+
+    std::vector<path_result> results(requests.size());
+    std::vector<direction> steps;
+    double new_ms = time_ms([&]() { pf.find_paths(requests, results, steps); });
+
+    size_t old_steps = 0;
+    double old_ms = time_ms([&]() {
+        for (const path_request& r : requests)
+        {
+            old_steps += old::find_path(map, r.from_x, r.from_y, r.to_x, r.to_y).size() - 1;
+        }
+    });
+
+    std::println("{} ({}):", label, pf.uses_jump_points() ? "jump point search" : "A*");
+    std::println("  attach: {:.3f} ms", attach_ms);
+    std::println("  pathfinder: {:.3f} ms for {} queries, {} steps", new_ms, requests.size(), steps.size());
+    std::println("  old find_path: {:.3f} ms for {} queries, {} steps", old_ms, requests.size(), old_steps);
+}
+
+int main()
+{
+    std::mt19937 rng(1234);
+    run("open dungeon", make_dungeon(rng, MAP_SIZE, 0), rng);
+    run("dungeon with a one-way tile", make_dungeon(rng, MAP_SIZE, 1), rng);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <chrono>
+
+// wall clock time f() takes
+template <typename F>
+double time_ms(F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template <typename F>
+double time_us(F&& f)
+{
+    return time_ms(f) * 1000.0;
+}
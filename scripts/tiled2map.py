@@ -4,71 +4,219 @@ import json
 import zlib
 import struct
 
-def write_str(f, s):
-    b = bytes(s, 'ascii')
-    f.write(struct.pack('<I', len(b)))
-    f.write(b)
+# see src/map_format.hpp for the layout of the file written by this script
 
-def write_layer(f, layer):
+MAP_FILE_MAGIC = 0x324d4655
+MAP_FILE_VERSION = 3
+MAP_NO_VALUE = 0xffffffff
+
+# must match tile_encoding in src/tilemap.hpp
+ENCODING_RAW32 = 0
+ENCODING_RLE16 = 1
+ENCODING_CHUNKED16 = 2
+TILE_RUN_NONE = 0xffff
+
+# must match CHUNK_TILES in src/tilemap.hpp
+CHUNK_TILES = 32
+
+# maps at least this many tiles are written in chunks so the game can stream them
+CHUNKED_MIN_TILES = 256 * 256
+
+HEADER_FORMAT = '<10I'
+STRING_ENTRY_FORMAT = '<II'
+LAYER_FORMAT = '<3I'
+ENTITY_FORMAT = '<8I2fI'
+PROPERTIES_FORMAT = '<4I5f2I'
+
+# must match entity_type in src/world.hpp
+ENTITY_TYPES = {
+    '': 0,
+    'npc': 1,
+    'door': 2,
+    'portal': 3,
+    'light': 4,
+    'switch': 5,
+}
+
+class string_table:
+    def __init__(self):
+        self.strings = []
+        self.index = {}
+        # index 0 is always the empty string
+        self.add('')
+
+    def add(self, s):
+        if s not in self.index:
+            self.index[s] = len(self.strings)
+            self.strings.append(s)
+        return self.index[s]
+
+    def pack(self):
+        entries = b''
+        data = b''
+        for s in self.strings:
+            b = bytes(s, 'ascii')
+            entries += struct.pack(STRING_ENTRY_FORMAT, len(data), len(b))
+            data += b
+        return entries + data
+
+def align4(b):
+    return b + bytes((4 - len(b) % 4) % 4)
+
+def read_layer(layer):
     data = zlib.decompress(base64.b64decode(layer['data']))
-    f.write(data)
-
-def write_dict(f, d):
-    print(d)
-    for k, v in d:
-        write_str(f, k)
-        f.write(struct.pack('<f', v))
-
-def write_variant(f, v):
-    if v['type'] == 'float':
-        write_str(f, v['name'])
-        f.write(struct.pack('c', bytes([0])))
-        f.write(struct.pack('<f', v['value']))
-    elif v['type'] == 'string':
-        write_str(f, v['name'])
-        f.write(struct.pack('c', bytes([1])))
-        write_str(f, v['value'])
-    elif v['type'] == 'int':
-        write_str(f, v['name'])
-        f.write(struct.pack('c', bytes([2])))
-        f.write(struct.pack('<I', v['value']))
-    else:
-        raise Exception('expected map property to be float, int, string, got {}'.format(v['type']))
-
-def write_props(f, props):
-    f.write(struct.pack('<I', len(props)))
+    ids = struct.unpack('<{}I'.format(len(data) // 4), data)
+    # tiled uses 0 for "no tile" and 1-based IDs otherwise; the engine wants 0-based IDs and
+    # UINT32_MAX for "no tile", which is exactly what the unsigned wraparound gives us
+    return [(i - 1) & 0xffffffff for i in ids]
+
+def encode_rle16(ids, width, height):
+    row_starts = [0]
+    runs = []
+    for y in range(height):
+        row = ids[y * width:(y + 1) * width]
+        for x, i in enumerate(row):
+            i16 = TILE_RUN_NONE if i == 0xffffffff else i
+            if x > 0 and runs[-1][0] == i16:
+                runs[-1][1] = x
+            else:
+                runs.append([i16, x])
+        row_starts.append(len(runs))
+    return (struct.pack('<{}I'.format(len(row_starts)), *row_starts) +
+            b''.join(struct.pack('<HH', i, x) for i, x in runs))
+
+def encode_chunk(ids, width, height, cx, cy):
+    row_starts = [0]
+    runs = []
+    for ly in range(CHUNK_TILES):
+        y = cy * CHUNK_TILES + ly
+        for lx in range(CHUNK_TILES):
+            x = cx * CHUNK_TILES + lx
+            # chunks past the edge of the map are padded with "no tile"
+            i = ids[y * width + x] if x < width and y < height else 0xffffffff
+            i16 = TILE_RUN_NONE if i == 0xffffffff else i
+            if lx > 0 and runs[-1][0] == i16:
+                runs[-1][1] = lx
+            else:
+                runs.append([i16, lx])
+        row_starts.append(len(runs))
+    return (align4(struct.pack('<{}H'.format(len(row_starts)), *row_starts)) +
+            b''.join(struct.pack('<HH', i, x) for i, x in runs))
+
+def encode_chunked16(ids, width, height):
+    chunks_w = (width + CHUNK_TILES - 1) // CHUNK_TILES
+    chunks_h = (height + CHUNK_TILES - 1) // CHUNK_TILES
+    index = b''
+    data = b''
+    # identical chunks (open sea, solid rock) share their data
+    offsets = {}
+    for cy in range(chunks_h):
+        for cx in range(chunks_w):
+            chunk = encode_chunk(ids, width, height, cx, cy)
+            if chunk not in offsets:
+                offsets[chunk] = len(data)
+                data += chunk
+            index += struct.pack('<II', offsets[chunk], len(chunk))
+    return index + data
+
+def encode_layer(ids, width, height):
+    # 16 bit IDs can't represent TILE_RUN_NONE or anything above it, and runs store the last
+    # column as 16 bits; anything else stays raw
+    if width <= 0x10000 and all(i == 0xffffffff or i < TILE_RUN_NONE for i in ids):
+        if width * height >= CHUNKED_MIN_TILES:
+            return ENCODING_CHUNKED16, encode_chunked16(ids, width, height)
+        return ENCODING_RLE16, encode_rle16(ids, width, height)
+    return ENCODING_RAW32, struct.pack('<{}I'.format(len(ids)), *ids)
+
+def props_to_dict(props):
+    d = {}
     for prop in props:
-        print(prop)
-        write_variant(f, prop)
+        if prop['type'] not in ('float', 'string', 'int'):
+            raise Exception('expected map property to be float, int, string, got {}'.format(prop['type']))
+        d[prop['name']] = prop['value']
+    return d
 
+def pack_entity(strings, obj):
+    props = props_to_dict(obj.get('properties', []))
+    return struct.pack(ENTITY_FORMAT,
+        strings.add(obj['name']),
+        ENTITY_TYPES.get(obj['class'], 0),
+        obj['x'],
+        obj['y'],
+        props.get('interact_id', MAP_NO_VALUE),
+        props.get('sprite_id', MAP_NO_VALUE),
+        strings.add(props.get('exit_map', '')),
+        strings.add(props.get('exit_name', '')),
+        props.get('light_radius', 0.0),
+        props.get('light_flicker_radius', 0.0),
+        props.get('active', 1))
 
-def write_objects(f, layer):
-    f.write(struct.pack('<I', len(layer['objects'])))
-    for obj in layer['objects']:
-        print(obj)
-        write_str(f, obj['name'])
-        write_str(f, obj['class'])
-        f.write(struct.pack('<II', obj['x'], obj['y']))
-        write_props(f, obj.get('properties', []))
+def pack_properties(strings, mapdata):
+    props = props_to_dict(mapdata.get('properties', []))
+    return struct.pack(PROPERTIES_FORMAT,
+        strings.add(props.get('map_name', 'Unnamed Zone')),
+        strings.add(props.get('map_subtitle', 'caption me')),
+        strings.add(props.get('music_name', '')),
+        strings.add(props.get('battle_field_name', '')),
+        props.get('water_direction_x', 0.0),
+        props.get('water_direction_y', 0.0),
+        props.get('water_drift_x', 0.0),
+        props.get('water_drift_y', 0.0),
+        props.get('water_speed', 0.0),
+        props.get('dark', 0),
+        props.get('encounter_set_id', MAP_NO_VALUE))
 
 with open(sys.argv[1], 'r') as f:
     mapdata = json.loads(f.read())
 
-with open(sys.argv[2], 'wb') as f:
-    print('write width/height')
-    f.write(struct.pack("<II", mapdata["width"], mapdata["height"]))
+layertbl = {layer['name']: layer for layer in mapdata['layers']}
+strings = string_table()
 
-    layertbl = {layer['name']: i for i, layer in enumerate(mapdata['layers'])}
+print('pack layers')
+width = mapdata['width']
+height = mapdata['height']
+encoded_layers = [encode_layer(read_layer(layertbl[name]), width, height) for name in ('base', 'detail', 'fringe')]
 
-    print('write base layer')
-    write_layer(f, mapdata['layers'][layertbl['base']])
-    print('write detail layer')
-    write_layer(f, mapdata['layers'][layertbl['detail']])
-    print('write fringe layer')
-    write_layer(f, mapdata['layers'][layertbl['fringe']])
+print('pack objects')
+objects = layertbl['objects']['objects']
+entities = b''.join(pack_entity(strings, obj) for obj in objects)
 
-    write_objects(f, mapdata['layers'][layertbl['objects']])
+print('pack properties')
+properties = pack_properties(strings, mapdata)
 
-    write_props(f, mapdata.get('properties', {}))
+string_data = align4(strings.pack())
+
+header_size = struct.calcsize(HEADER_FORMAT)
+string_table_offset = header_size
+layers_offset = string_table_offset + len(string_data)
+
+# layer table, then each layer's data
+layer_table = b''
+layer_data = b''
+data_offset = layers_offset + 3 * struct.calcsize(LAYER_FORMAT)
+for encoding, data in encoded_layers:
+    layer_table += struct.pack(LAYER_FORMAT, encoding, data_offset + len(layer_data), len(data))
+    layer_data += align4(data)
+layers = layer_table + layer_data
+
+entities_offset = layers_offset + len(layers)
+properties_offset = entities_offset + len(entities)
+
+with open(sys.argv[2], 'wb') as f:
+    f.write(struct.pack(HEADER_FORMAT,
+        MAP_FILE_MAGIC,
+        MAP_FILE_VERSION,
+        width,
+        height,
+        string_table_offset,
+        len(strings.strings),
+        layers_offset,
+        entities_offset,
+        len(objects),
+        properties_offset))
+    f.write(string_data)
+    f.write(layers)
+    f.write(entities)
+    f.write(properties)
 
-    print('done')
+print('done')
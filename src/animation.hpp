@@ -1,12 +1,37 @@
 #pragma once
 
+#include <array>
+#include <cassert>
 #include <cstdint>
-#include <string>
-#include <unordered_map>
-#include <vector>
+#include <initializer_list>
 
 #include "rectangle.hpp"
 
+// every animation name used by the sprite tables, interned
+enum animation_id : uint8_t
+{
+    anim_default, // ""
+    anim_down,
+    anim_left,
+    anim_right,
+    anim_up,
+    anim_dead,
+    anim_dead2,
+    anim_closed,
+    anim_open,
+    anim_closed_open,
+    anim_off,
+    anim_on,
+    anim_off_on,
+    anim_on_off,
+
+    ANIMATION_ID_COUNT
+};
+
+constexpr size_t MAX_ANIMATION_FRAMES = 8;
+constexpr size_t MAX_SET_ANIMATIONS = 6;
+constexpr size_t MAX_ANIMATION_CLOCKS = 16;
+
 struct animation_frame
 {
     rectangle rect;
@@ -15,29 +40,107 @@ struct animation_frame
 
 struct animation
 {
-    std::vector<animation_frame> frames;
-    std::string next_animation;
+    std::array<animation_frame, MAX_ANIMATION_FRAMES> frames{};
+    uint8_t frame_count = 0;
+    uint32_t loop_time = 0;
+
+    // played once this one finishes; only followed if the set has it (see animation_set)
+    animation_id next = anim_default;
+    bool has_next = false;
+
+    constexpr animation() = default;
+
+    constexpr animation(std::initializer_list<animation_frame> f, animation_id next_ = anim_default)
+        : next{next_}
+    {
+        assert(f.size() > 0 && f.size() <= MAX_ANIMATION_FRAMES);
+        for (const animation_frame& frame : f)
+        {
+            assert(frame.frame_time > 0);
+            frames[frame_count++] = frame;
+            loop_time += frame.frame_time;
+        }
+    }
+};
+
+struct named_animation
+{
+    animation_id id;
+    animation anim;
 };
 
+// frame index of each animation of every globally clocked set, indexed by clock and then by
+// animation slot. written once per tick by update_animation_clocks().
+extern std::array<std::array<uint8_t, MAX_SET_ANIMATIONS>, MAX_ANIMATION_CLOCKS> animation_clock_frames;
+
+// A sprite's animations, flattened so that looking one up is an array index. Built at compile
+// time from the tables in animation_data.cpp.
+//
+// Sets whose animations only ever loop can be globally clocked: their frames follow the game's
+// frame counter, so every animator using them shows the same frame and has nothing to update.
 struct animation_set
 {
-    std::unordered_map<std::string, animation> anims;
+    static constexpr uint8_t NO_SLOT = UINT8_MAX;
+    static constexpr uint8_t NO_CLOCK = UINT8_MAX;
+
+    std::array<animation, MAX_SET_ANIMATIONS> anims{};
+    std::array<uint8_t, ANIMATION_ID_COUNT> slots{};
+    uint8_t count = 0;
+
+    // wants a global clock; clock is assigned once all sets are known
+    bool global_clock = false;
+    uint8_t clock = NO_CLOCK;
+
+    constexpr animation_set(std::initializer_list<named_animation> list, bool global_clock_ = false)
+        : global_clock{global_clock_}
+    {
+        slots.fill(NO_SLOT);
+
+        for (const named_animation& a : list)
+        {
+            assert(count < MAX_SET_ANIMATIONS && slots[a.id] == NO_SLOT);
+            slots[a.id] = count;
+            anims[count++] = a.anim;
+        }
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            // chaining into itself is just looping
+            anims[i].has_next = has(anims[i].next) && slots[anims[i].next] != i;
+            assert(!(global_clock && anims[i].has_next));
+        }
+    }
+
+    constexpr bool has(animation_id id) const
+    {
+        return slots[id] != NO_SLOT;
+    }
+
+    constexpr const animation& get(animation_id id) const
+    {
+        assert(has(id));
+        return anims[slots[id]];
+    }
 };
 
 struct animator
 {
-    const animation_set* aset;
-    std::string current_name;
-    size_t frame_index = 0;
+    const animation_set* aset = nullptr;
+    animation_id current = anim_default;
+    uint8_t frame_index = 0;
     uint32_t counter = 0;
 
     const animation& current_animation() const
     {
-        return aset->anims.at(current_name);
+        return aset->get(current);
     }
 
     const animation_frame& current_frame() const
     {
+        if (aset->clock != animation_set::NO_CLOCK)
+        {
+            return current_animation().frames[animation_clock_frames[aset->clock][aset->slots[current]]];
+        }
         return current_animation().frames[frame_index];
     }
 
@@ -46,25 +149,50 @@ struct animator
         return current_frame().rect;
     }
 
-    void update()
+    // several ticks at once for animators that aren't updated every tick
+    void update(uint32_t ticks = 1)
     {
-        ++counter;
-        if (counter >= current_frame().frame_time)
+        if (aset->clock != animation_set::NO_CLOCK)
+        {
+            return;
+        }
+
+        counter += ticks;
+        for (;;)
         {
-            counter = 0;
+            const animation& a = current_animation();
+            const uint32_t frame_time = a.frames[frame_index].frame_time;
+            if (counter < frame_time)
+            {
+                break;
+            }
+
+            counter -= frame_time;
             ++frame_index;
 
-            if (frame_index == current_animation().frames.size())
+            if (frame_index == a.frame_count)
             {
                 frame_index = 0;
-                if (aset->anims.count(current_animation().next_animation))
+                if (a.has_next)
                 {
-                    current_name = current_animation().next_animation;
+                    current = a.next;
                 }
             }
         }
     }
 
+    // nothing update() would ever change on screen
+    bool is_static() const
+    {
+        if (aset->clock != animation_set::NO_CLOCK)
+        {
+            return true;
+        }
+
+        const animation& a = current_animation();
+        return a.frame_count == 1 && !a.has_next;
+    }
+
     void reset()
     {
         counter = 0;
@@ -76,16 +204,16 @@ struct animator
         aset = a;
     }
 
-    void set_animation(const std::string& name)
+    void set_animation(animation_id id)
     {
-        if (current_name == name)
+        if (current == id)
         {
             return;
         }
 
-        if (aset->anims.count(name))
+        if (aset->has(id))
         {
-            current_name = name;
+            current = id;
             reset();
         }
     }
@@ -3,3 +3,6 @@
 #include "animation.hpp"
 
 const animation_set* get_animation_set(uint32_t id);
+
+// advances every globally clocked animation set to the given tick
+void update_animation_clocks(uint32_t tick);
@@ -1,10 +1,11 @@
 #include "audio.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <filesystem>
+#include <format>
 #include <stb_vorbis.h>
-
-#include "mathutil.hpp"
+#include <stdexcept>
 
 static void load_audio(const char* filename, audio_buffer& buffer)
 {
@@ -13,11 +14,6 @@ static void load_audio(const char* filename, audio_buffer& buffer)
 
 void audio_system::init()
 {
-    // probably will never need this many but this is not something that we want to keep reallocating
-    // also !!!!!IMPORTANT!!!!! this modifies tracks without a mutex so it MUST be done before starting
-    // the audio callback or decode thread
-    tracks.reserve(1024);
-
     SDL_AudioSpec want;
     SDL_memset(&want, 0, sizeof(want));
     want.freq = 44100;
@@ -29,37 +25,20 @@ void audio_system::init()
     device = SDL_OpenAudioDevice(NULL, 0, &want, &spec, 0);
     SDL_PauseAudioDevice(device, 0);
 
+    // only ever fills in buffers; the callback skips a voice until its buffer has samples
     decode_thread = std::thread([&]() {
-        std::vector<decode_request> local_queue;
-
         while (true)
         {
-            // wait for queue to fill up
-            std::unique_lock<std::mutex> lk(decode_queue_m);
-            decode_cv.wait(lk, [&]() { return decode_queue.size(); });
-
-            // quickly take the decode queue
-            std::swap(local_queue, decode_queue);
+            decode_ready.acquire();
 
-            // release as soon as we're done with the queue
-            lk.unlock();
-
-            // load requests sequentially and put them into the tracklist
-            for (decode_request& req : local_queue)
+            decode_request req;
+            while (decode_queue.pop(req))
             {
-                // empty filename kills the thread
-                if (req.filename.size() == 0)
+                if (!req.buffer)
                     return;
 
-                audio_track t;
-                t.buffer = get_or_load(req.filename.c_str());
-                t.loop = req.loop;
-                t.parameters = std::move(req.parameters);
-                std::scoped_lock lk_tracks(tracks_m);
-                tracks.push_back(std::move(t));
+                load_audio(req.filename, *req.buffer);
             }
-
-            local_queue.clear();
         }
     });
 }
@@ -92,87 +71,274 @@ audio_buffer* audio_system::get_or_load(const char* filename)
     }
 }
 
-std::shared_ptr<audio_parameters> audio_system::play_sound(const char* filename)
+audio_buffer* audio_system::preload(const std::string& filename)
+{
+    decode_request req;
+    {
+        std::scoped_lock lk(cache_m);
+        auto [it, inserted] = cache.try_emplace(filename);
+        if (!inserted)
+        {
+            return &it->second;
+        }
+        // map nodes don't move, so the key outlives the request
+        req = {it->first.c_str(), &it->second};
+    }
+
+    // the decode thread drains the queue far faster than anything fills it
+    while (!decode_queue.push(req))
+    {
+        std::this_thread::yield();
+    }
+    decode_ready.release();
+    return req.buffer;
+}
+
+sound_id audio_system::register_sound(const char* name)
 {
-    auto parameters = std::make_shared<audio_parameters>();
+    for (size_t i = 0; i < sound_names.size(); ++i)
     {
-        std::scoped_lock lk(decode_queue_m);
-        decode_queue.push_back({filename, false, parameters});
+        if (sound_names[i] == name)
+        {
+            return static_cast<sound_id>(i);
+        }
     }
-    decode_cv.notify_one();
-    return parameters;
+
+    if (sound_names.size() == MAX_SOUNDS)
+    {
+        throw std::runtime_error("too many registered sounds");
+    }
+
+    std::string filename = std::format("assets/sound/{}.ogg", name);
+    assert(std::filesystem::exists(filename));
+
+    const sound_id id = static_cast<sound_id>(sound_names.size());
+    sound_names.emplace_back(name);
+    sound_buffers[id] = preload(filename);
+    return id;
 }
 
-std::shared_ptr<audio_parameters> audio_system::play_music(const char* filename)
+void audio_system::send(const audio_command& cmd)
 {
-    auto parameters = std::make_shared<audio_parameters>();
+    if (!commands.push(cmd))
     {
-        std::scoped_lock lk(decode_queue_m);
-        decode_queue.push_back({filename, true, parameters});
+        dropped_commands.fetch_add(1, std::memory_order_relaxed);
     }
-    decode_cv.notify_one();
-    return parameters;
 }
 
-void audio_system::audio_callback(void* userdata, Uint8* stream, int len)
+void audio_system::play_sound(sound_id id)
 {
-    audio_system* self = (audio_system*)userdata;
-    SDL_memset(stream, 0, len);
-    short* data_base = (short*)stream;
+    assert(id < sound_names.size());
+    send({audio_command::play, false, NO_PLAYBACK, 1.f, sound_buffers[id]});
+}
+
+playback_id audio_system::play(const char* filename, bool loop)
+{
+    assert(std::filesystem::exists(filename));
+
+    const playback_id playback = ++last_playback;
+    send({audio_command::play, loop, playback, 1.f, preload(filename)});
+    return playback;
+}
+
+playback_id audio_system::play_sound(const char* filename)
+{
+    return play(filename, false);
+}
+
+playback_id audio_system::play_music(const char* filename)
+{
+    return play(filename, true);
+}
+
+void audio_system::stop(playback_id playback)
+{
+    if (playback != NO_PLAYBACK)
+    {
+        send({audio_command::stop, false, playback});
+    }
+}
+
+void audio_system::set_volume(playback_id playback, float volume)
+{
+    if (playback != NO_PLAYBACK)
+    {
+        send({audio_command::set_volume, false, playback, volume});
+    }
+}
+
+void audio_system::set_paused(playback_id playback, bool paused)
+{
+    if (playback != NO_PLAYBACK)
+    {
+        send({audio_command::set_paused, paused, playback});
+    }
+}
 
-    std::scoped_lock lk(self->tracks_m);
+audio_stats audio_system::stats() const
+{
+    return {
+        callbacks.load(std::memory_order_relaxed),
+        underruns.load(std::memory_order_relaxed),
+        max_callback_us.load(std::memory_order_relaxed),
+        dropped_voices.load(std::memory_order_relaxed),
+        dropped_commands.load(std::memory_order_relaxed),
+    };
+}
 
-    for (audio_track& track : self->tracks)
+void audio_system::run_command(const audio_command& cmd)
+{
+    if (cmd.type == audio_command::play)
     {
-        audio_buffer* buffer = track.buffer;
-        float volume = track.parameters->volume;
+        if (voice_count == voices.size())
+        {
+            dropped_voices.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
 
-        if (track.parameters->paused)
+        audio_voice& v = voices[voice_count++];
+        v = {};
+        v.buffer = cmd.buffer;
+        v.playback = cmd.playback;
+        v.loop = cmd.flag;
+        return;
+    }
+
+    for (size_t i = 0; i < voice_count; ++i)
+    {
+        audio_voice& v = voices[i];
+        if (v.playback != cmd.playback)
+        {
             continue;
+        }
+
+        switch (cmd.type)
+        {
+        case audio_command::stop:
+            v.done = true;
+            break;
+        case audio_command::set_volume:
+            v.volume = cmd.volume;
+            break;
+        case audio_command::set_paused:
+            v.paused = cmd.flag;
+            break;
+        default:
+            break;
+        }
+        return;
+    }
+}
+
+void audio_system::mix(short* out, size_t sample_count)
+{
+    assert(sample_count <= mix_bus.size());
+    float* bus = mix_bus.data();
+    std::fill_n(bus, sample_count, 0.f);
+
+    for (size_t i = 0; i < voice_count; ++i)
+    {
+        audio_voice& voice = voices[i];
+        audio_buffer* buffer = voice.buffer;
 
-        if (!buffer->sample_count)
+        if (voice.paused)
             continue;
 
-        short* data = data_base;
+        // sounds still being decoded start once they're ready; ones that failed to decode never will
+        const int buffer_samples = buffer->sample_count.load(std::memory_order_acquire);
+        if (buffer_samples < 0)
+            voice.done = true;
+        if (buffer_samples <= 0)
+            continue;
 
-        for (size_t samp = 0; samp < len / sizeof(short); ++samp)
+        // whole spans up to the end of the buffer, where the voice loops or stops
+        const size_t length = 2 * static_cast<size_t>(buffer_samples);
+        size_t mixed = 0;
+        while (mixed < sample_count && !voice.done)
         {
-            if (track.done)
-                break;
-
-            *data = (short)clamp<int>(*data + static_cast<short>(*(buffer->samples + track.cursor) * volume), SHRT_MIN, SHRT_MAX);
-            ++data;
-            ++track.cursor;
+            const size_t n = std::min(sample_count - mixed, length - voice.cursor);
+            mix_span(bus + mixed, buffer->samples + voice.cursor, n, voice.volume);
+            mixed += n;
+            voice.cursor += n;
 
-            if (track.cursor == 2 * buffer->sample_count)
+            if (voice.cursor == length)
             {
-                if (track.loop)
+                if (voice.loop)
                 {
-                    track.cursor = 0;
+                    voice.cursor = 0;
                 }
                 else
                 {
-                    track.done = true;
+                    voice.done = true;
                 }
             }
         }
     }
 
-    // TODO: this was raising an STL iterator-out-of-range error after reserving memory ahead of time
-    // it seems like remove_if returns an invalid iterator if the collection is empty; need to investigate
-    if (self->tracks.size())
+    limiter.process(out, bus, sample_count);
+
+    // swap finished voices out; order doesn't matter to the mix
+    for (size_t i = 0; i < voice_count;)
+    {
+        if (voices[i].done)
+        {
+            voices[i] = voices[--voice_count];
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void audio_system::audio_callback(void* userdata, Uint8* stream, int len)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    audio_system* self = (audio_system*)userdata;
+
+    audio_command cmd;
+    while (self->commands.pop(cmd))
+    {
+        self->run_command(cmd);
+    }
+
+    short* out = (short*)stream;
+    const size_t sample_count = len / sizeof(short);
+    for (size_t i = 0; i < sample_count; i += MIX_BUS_SIZE)
     {
-        self->tracks.erase(
-            std::remove_if(self->tracks.begin(), self->tracks.end(), [](const audio_track& t) {
-                return t.done || t.parameters->done;
-            }),
-            self->tracks.end());
+        self->mix(out + i, std::min(MIX_BUS_SIZE, sample_count - i));
+    }
+
+    const uint64_t us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    const uint64_t budget_us = 1'000'000ull * sample_count / self->spec.channels / self->spec.freq;
+
+    self->callbacks.fetch_add(1, std::memory_order_relaxed);
+    if (us > budget_us)
+    {
+        self->underruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (us > self->max_callback_us.load(std::memory_order_relaxed))
+    {
+        self->max_callback_us.store(us, std::memory_order_relaxed);
     }
 }
 
 audio_system::~audio_system()
 {
-    // signal decode thread to exit
-    play_sound("");
-    decode_thread.join();
+    if (device)
+    {
+        SDL_CloseAudioDevice(device);
+    }
+
+    if (decode_thread.joinable())
+    {
+        // a null buffer stops the decode thread
+        while (!decode_queue.push({}))
+        {
+            std::this_thread::yield();
+        }
+        decode_ready.release();
+        decode_thread.join();
+    }
 }
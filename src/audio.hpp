@@ -1,12 +1,23 @@
 #pragma once
 
 #include <SDL.h>
+#include <array>
 #include <atomic>
-#include <memory>
+#include <cstdint>
 #include <mutex>
+#include <semaphore>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#include "audio_mix.hpp"
+#include "spsc_ring.hpp"
+
+// a sound registered with audio_system::register_sound
+using sound_id = uint16_t;
+constexpr sound_id NO_SOUND = UINT16_MAX;
+
 struct audio_buffer
 {
     int channels = 0;
@@ -21,27 +32,59 @@ struct audio_buffer
     }
 };
 
-struct audio_parameters
+// a sound started with play_sound(filename) or play_music, for stopping it or changing how it plays
+using playback_id = uint32_t;
+constexpr playback_id NO_PLAYBACK = 0;
+
+// game thread -> audio callback
+struct audio_command
 {
-    std::atomic<float> volume = 1.f;
-    std::atomic<bool> done = false;
-    std::atomic<bool> paused = false;
+    enum kind : uint8_t
+    {
+        play,
+        stop,
+        set_volume,
+        set_paused,
+    };
+
+    kind type = play;
+    bool flag = false; // loop for play, paused for set_paused
+    playback_id playback = NO_PLAYBACK;
+    float volume = 1.f;
+    audio_buffer* buffer = nullptr;
 };
 
-struct audio_track
+// something the audio callback is playing. the callback's alone, so never locked
+struct audio_voice
 {
     audio_buffer* buffer = nullptr;
-    int cursor = 0;
+    playback_id playback = NO_PLAYBACK;
+    size_t cursor = 0;
+    float volume = 1.f;
     bool loop = false;
+    bool paused = false;
     bool done = false;
-    std::shared_ptr<audio_parameters> parameters;
 };
 
+// game thread -> decode thread; filename is the buffer's key in the cache. a null buffer stops
+// the thread
 struct decode_request
 {
-    std::string filename;
-    bool loop;
-    std::shared_ptr<audio_parameters> parameters;
+    const char* filename = nullptr;
+    audio_buffer* buffer = nullptr;
+};
+
+// how well the audio callback keeps up, for showing it never waits on anything
+struct audio_stats
+{
+    uint64_t callbacks = 0;
+    // callbacks that took longer than the audio they mixed lasts, so the device ran dry
+    uint64_t underruns = 0;
+    uint64_t max_callback_us = 0;
+    // plays the callback had no free voice for
+    uint64_t dropped_voices = 0;
+    // commands the game thread found no room for
+    uint64_t dropped_commands = 0;
 };
 
 class audio_system
@@ -53,28 +96,76 @@ public:
 
     ~audio_system();
 
+    static constexpr size_t MAX_SOUNDS = 256;
+    static constexpr size_t MAX_VOICES = 256;
+    static constexpr size_t COMMAND_QUEUE_SIZE = 1024;
+    static constexpr size_t DECODE_QUEUE_SIZE = 256;
+    // samples mixed at a time; callbacks asking for more are mixed in pieces
+    static constexpr size_t MIX_BUS_SIZE = 1024;
+
     void init();
 
-    std::shared_ptr<audio_parameters> play_sound(const char* filename);
-    std::shared_ptr<audio_parameters> play_music(const char* filename);
+    // a file is decoded in the background the first time it's played and starts once it's ready.
+    // game thread only, like everything below that talks to the callback.
+    playback_id play_sound(const char* filename);
+    playback_id play_music(const char* filename);
+
+    // name is "stab" for assets/sound/stab.ogg. loading starts in the background, and registering
+    // a name again gives back the same id.
+    sound_id register_sound(const char* name);
+
+    // no strings, locks or allocation: the audio callback starts the sound.
+    void play_sound(sound_id id);
+
+    // ignored for NO_PLAYBACK and for sounds that have already finished
+    void stop(playback_id playback);
+    void set_volume(playback_id playback, float volume);
+    void set_paused(playback_id playback, bool paused);
+
+    audio_stats stats() const;
 
     audio_buffer* get_or_load(const char* filename);
 
 private:
     static void audio_callback(void* userdata, Uint8* stream, int len);
 
-    SDL_AudioDeviceID device;
-    SDL_AudioSpec spec;
+    // at most MIX_BUS_SIZE samples
+    void mix(short* out, size_t sample_count);
+    void run_command(const audio_command& cmd);
+
+    // finds or creates the cache entry for filename, queueing a load if it's new
+    audio_buffer* preload(const std::string& filename);
+    playback_id play(const char* filename, bool loop);
+    void send(const audio_command& cmd);
 
-    std::mutex tracks_m;
-    std::vector<audio_track> tracks;
+    SDL_AudioDeviceID device = 0;
+    SDL_AudioSpec spec;
 
     std::mutex cache_m;
     std::unordered_map<std::string, audio_buffer> cache;
 
+    // registered sounds, touched only by the game thread
+    std::vector<std::string> sound_names;
+    std::array<audio_buffer*, MAX_SOUNDS> sound_buffers{};
+
+    playback_id last_playback = NO_PLAYBACK;
+
+    spsc_ring<audio_command, COMMAND_QUEUE_SIZE> commands;
+    std::atomic<uint64_t> dropped_commands = 0;
+
+    //== audio callback only =======================================
+    std::array<audio_voice, MAX_VOICES> voices{};
+    size_t voice_count = 0;
+    std::array<float, MIX_BUS_SIZE> mix_bus{};
+    audio_limiter limiter;
+
+    std::atomic<uint64_t> callbacks = 0;
+    std::atomic<uint64_t> underruns = 0;
+    std::atomic<uint64_t> max_callback_us = 0;
+    std::atomic<uint64_t> dropped_voices = 0;
+
     //== load / decode thread ======================================
     std::thread decode_thread;
-    std::mutex decode_queue_m;
-    std::vector<decode_request> decode_queue;
-    std::condition_variable decode_cv;
+    spsc_ring<decode_request, DECODE_QUEUE_SIZE> decode_queue;
+    std::counting_semaphore<> decode_ready{0};
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AUDIO_MIX_SSE2 1
+#endif
+
+// The audio callback's mixing kernels. Voices are summed into a float bus in the same units as
+// the 16-bit output, so they can't clip each other on the way; only the final conversion back to
+// shorts saturates. SSE2 is all x86-64 guarantees and this is memory bound anyway, so there are no
+// wider versions. Spans can be any length and alignment.
+
+// bus[i] += src[i] * volume
+inline void mix_span(float* bus, const short* src, size_t n, float volume)
+{
+    size_t i = 0;
+#ifdef AUDIO_MIX_SSE2
+    const __m128 v = _mm_set1_ps(volume);
+    for (const size_t vector_end = n & ~size_t(7); i < vector_end; i += 8)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        // sign extend by putting each short in the top half of a lane and shifting back down
+        const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        _mm_storeu_ps(bus + i, _mm_add_ps(_mm_loadu_ps(bus + i), _mm_mul_ps(lo, v)));
+        _mm_storeu_ps(bus + i + 4, _mm_add_ps(_mm_loadu_ps(bus + i + 4), _mm_mul_ps(hi, v)));
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        bus[i] += static_cast<float>(src[i]) * volume;
+    }
+}
+
+// the largest magnitude on the bus
+inline float bus_peak(const float* bus, size_t n)
+{
+    size_t i = 0;
+    float peak = 0;
+#ifdef AUDIO_MIX_SSE2
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 m = _mm_setzero_ps();
+    for (const size_t vector_end = n & ~size_t(3); i < vector_end; i += 4)
+    {
+        m = _mm_max_ps(m, _mm_and_ps(_mm_loadu_ps(bus + i), abs_mask));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, m);
+    peak = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+    for (; i < n; ++i)
+    {
+        peak = std::max(peak, std::abs(bus[i]));
+    }
+    return peak;
+}
+
+// out[i] = saturate(bus[i] * gain), with gain going linearly from gain_from towards gain_to over
+// the span so a change of gain never steps
+inline void bus_to_s16(short* out, const float* bus, size_t n, float gain_from, float gain_to)
+{
+    const float step = n ? (gain_to - gain_from) / static_cast<float>(n) : 0.f;
+    size_t i = 0;
+#ifdef AUDIO_MIX_SSE2
+    __m128 g0 = _mm_setr_ps(gain_from, gain_from + step, gain_from + 2 * step, gain_from + 3 * step);
+    __m128 g1 = _mm_add_ps(g0, _mm_set1_ps(4 * step));
+    const __m128 g_step = _mm_set1_ps(8 * step);
+    for (const size_t vector_end = n & ~size_t(7); i < vector_end; i += 8)
+    {
+        // rounds to nearest, and the pack saturates to the range of a short
+        const __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(bus + i), g0));
+        const __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(bus + i + 4), g1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+        g0 = _mm_add_ps(g0, g_step);
+        g1 = _mm_add_ps(g1, g_step);
+    }
+#endif
+    for (; i < n; ++i)
+    {
+        const float s = bus[i] * (gain_from + step * static_cast<float>(i));
+        out[i] = static_cast<short>(std::lrint(std::clamp(s, static_cast<float>(SHRT_MIN), static_cast<float>(SHRT_MAX))));
+    }
+}
+
+// Keeps the mix from clipping when many voices pile up. The gain drops at once to put a block's
+// loudest sample at full scale, then recovers over RELEASE_BLOCKS blocks, ramping across each so
+// it never steps up.
+struct audio_limiter
+{
+    // about a tenth of a second of 128 frame blocks at 44.1kHz
+    static constexpr float RELEASE_BLOCKS = 35;
+
+    float gain = 1.f;
+
+    void process(short* out, const float* bus, size_t n)
+    {
+        const float peak = bus_peak(bus, n);
+        const float needed = peak > SHRT_MAX ? SHRT_MAX / peak : 1.f;
+
+        if (needed < gain)
+        {
+            gain = needed;
+            bus_to_s16(out, bus, n, gain, gain);
+        }
+        else
+        {
+            const float next = std::min(needed, gain + 1.f / RELEASE_BLOCKS);
+            bus_to_s16(out, bus, n, gain, next);
+            gain = next;
+        }
+    }
+};
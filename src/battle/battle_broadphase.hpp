@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "../rectangle.hpp"
+#include "battle_character.hpp"
+
+// Character hitboxes sorted by their left edge, so a projectile only has to look at the ones
+// whose x range it overlaps. Characters don't move while projectiles are being resolved, so
+// battle_field rebuilds this once per tick.
+class battle_broadphase
+{
+public:
+    // every character except skip_index
+    void build(const std::vector<battle_character>& characters, size_t skip_index)
+    {
+        entries.clear();
+        max_width = 0;
+        for (size_t i = 0; i < characters.size(); ++i)
+        {
+            if (i == skip_index)
+            {
+                continue;
+            }
+
+            const rectangle box = characters[i].worldspace_hitbox();
+            entries.push_back({box, i});
+            max_width = std::max(max_width, box.w);
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) {
+            return a.box.x < b.box.x;
+        });
+    }
+
+    // indices of the characters whose hitboxes touch r, in index order like a full scan would
+    // visit them
+    void query(const rectangle& r, std::vector<size_t>& out) const
+    {
+        out.clear();
+
+        // nothing starting further left than this can reach r
+        const int first_x = r.left() - max_width;
+        auto it = std::lower_bound(entries.begin(), entries.end(), first_x, [](const entry& e, int x) {
+            return e.box.x < x;
+        });
+
+        // touching edges count, as with rectangle::intersect
+        for (; it != entries.end() && it->box.x <= r.right(); ++it)
+        {
+            const rectangle& b = it->box;
+            if (b.right() >= r.left() && b.top() <= r.bottom() && b.bottom() >= r.top())
+            {
+                out.push_back(it->index);
+            }
+        }
+
+        std::sort(out.begin(), out.end());
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    struct entry
+    {
+        rectangle box;
+        size_t index;
+    };
+
+    std::vector<entry> entries;
+    int max_width = 0;
+};
@@ -1,25 +1,5 @@
 #include "battle_character.hpp"
 
-void battle_character::use_skill(battle_field& b_field, skill* sk)
-{
-    if (sk->can_use(*this))
-    {
-        sk->use(b_field, *this);
-
-        if (sk->cast_time() > 0)
-        {
-            current_skill = sk;
-        }
-
-        frames_since_skill_start = 0;
-    }
-}
-
-void battle_character::use_skill_unconditionally(battle_field& b_field, skill* sk)
-{
-    sk->use(b_field, *this);
-}
-
 void battle_character::update(float floor)
 {
     prev_pos = pos;
@@ -76,8 +56,8 @@ void battle_character::update(float floor)
     }
 
     ++frames_since_skill_start;
-    if (current_skill && frames_since_skill_start == current_skill->cast_time())
+    if (current_skill != skill_none && frames_since_skill_start == SKILL_INFO[current_skill].cast_time)
     {
-        current_skill = nullptr;
+        current_skill = skill_none;
     }
 }
\ No newline at end of file
@@ -2,7 +2,6 @@
 
 #include <glm/gtx/compatibility.hpp>
 #include <glm/vec2.hpp>
-#include <memory>
 
 #include "../animation.hpp"
 #include "../animation_data.hpp"
@@ -11,8 +10,6 @@
 #include "battle_character_info.hpp"
 #include "skill.hpp"
 
-struct skill;
-
 struct battle_character
 {
     size_t id = SIZE_MAX;
@@ -30,22 +27,40 @@ struct battle_character
     int32_t power = 1;
 
     uint32_t frames_since_skill_start = 0;
-    skill* current_skill = nullptr;
+    skill_id current_skill = skill_none;
     const battle_character_info* info;
-    std::unique_ptr<bc_controller> controller;
 
     battle_character(size_t id_, const battle_character_info* i)
     {
         id = id_;
         info = i;
         anim.set_animation_set(get_animation_set(i->sprite_id));
-        anim.set_animation("down");
+        anim.set_animation(anim_down);
 
         life = i->max_life;
     }
 
-    void use_skill(battle_field& b_field, skill* sk);
-    void use_skill_unconditionally(battle_field& b_field, skill* sk);
+    template <typename S>
+    void use_skill(battle_field& b_field, S& sk)
+    {
+        if (sk.can_use(*this))
+        {
+            sk.use(b_field, *this);
+
+            if (SKILL_INFO[S::ID].cast_time > 0)
+            {
+                current_skill = S::ID;
+            }
+
+            frames_since_skill_start = 0;
+        }
+    }
+
+    template <typename S>
+    void use_skill_unconditionally(battle_field& b_field, S& sk)
+    {
+        sk.use(b_field, *this);
+    }
 
     void set_fly_state(bool is_flying)
     {
@@ -55,7 +70,7 @@ struct battle_character
     void kill()
     {
         alive = false;
-        anim.set_animation("dead");
+        anim.set_animation(anim_dead);
     }
 
     void hurt(int32_t amt)
@@ -72,7 +87,7 @@ struct battle_character
 
     bool can_act() const
     {
-        return alive && current_skill == nullptr;
+        return alive && current_skill == skill_none;
     }
 
     void jump()
@@ -108,7 +123,7 @@ struct battle_character
             }
         }
         facing = left;
-        anim.set_animation("left");
+        anim.set_animation(anim_left);
     }
 
     void move_right()
@@ -135,7 +150,7 @@ struct battle_character
             }
         }
         facing = right;
-        anim.set_animation("right");
+        anim.set_animation(anim_right);
     }
 
     void fly_towards(const glm::vec2& point, float speed_mul = 1.f)
@@ -155,11 +170,11 @@ struct battle_character
 
             if (dir.x < 0)
             {
-                anim.set_animation("left");
+                anim.set_animation(anim_left);
             }
             else
             {
-                anim.set_animation("right");
+                anim.set_animation(anim_right);
             }
         }
     }
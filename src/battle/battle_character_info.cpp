@@ -1,14 +1,39 @@
 #include "battle_character_info.hpp"
 
+#include <format>
+
 // clang-format off
 battle_character_info B_CHARINFO[BCI_MAX]{
-    {5,  0, 4.f,  4.f, 0.65f, 0.50f, "stab",   16, nullptr, 0},
-    {5,  4, 2.f,  5.f, 0.98f, 0.10f, "slime0", 21, slime_controller::create, 1},
-    {15, 3, 2.5f, 3.f, 0.65f, 0.70f, "bone",   22, skeleton_controller::create, 3},
-    {15, 5, 3.0f, 0.f, 0.98f, 1.00f, "stab",   16, bat_controller::create, 5},
-    {30, 6, 2.5f, 3.f, 0.65f, 0.70f, "stab",   23, ghost_controller::create, 10},
+    {5,  0, 4.f,  4.f, 0.65f, 0.50f, "stab",   16, ct_none,     0},
+    {5,  4, 2.f,  5.f, 0.98f, 0.10f, "slime0", 21, ct_slime,    1},
+    {15, 3, 2.5f, 3.f, 0.65f, 0.70f, "bone",   22, ct_skeleton, 3},
+    {15, 5, 3.0f, 0.f, 0.98f, 1.00f, "stab",   16, ct_bat,      5},
+    {30, 6, 2.5f, 3.f, 0.65f, 0.70f, "stab",   23, ct_ghost,    10},
     // spider
-    {15, 7, 2.5f, 3.f, 0.65f, 0.70f, "stab",   16, skeleton_controller::create, 10},
+    {15, 7, 2.5f, 3.f, 0.65f, 0.70f, "stab",   16, ct_skeleton, 10},
     // THAT guy
-    {1000,  0, 4.f,  4.f, 0.65f, 0.50f, "stab",   16, ragworm_controller::create, 1000},
+    {1000,  0, 4.f,  4.f, 0.65f, 0.50f, "stab",   16, ct_ragworm,  1000},
 };
+// clang-format on
+
+battle_sound_ids BATTLE_SOUNDS;
+
+void register_battle_sounds(audio_system& audio)
+{
+    for (battle_character_info& info : B_CHARINFO)
+    {
+        info.hurt_sound_id = audio.register_sound(info.hurt_sound);
+    }
+
+    BATTLE_SOUNDS.throw_knife = audio.register_sound("throw1");
+    BATTLE_SOUNDS.flash_jump = audio.register_sound("flashjump");
+    BATTLE_SOUNDS.avenger = audio.register_sound("avenger");
+    BATTLE_SOUNDS.torch = audio.register_sound("torch");
+    BATTLE_SOUNDS.knife_draw = audio.register_sound("knifedraw");
+    BATTLE_SOUNDS.warp = audio.register_sound("warpspell");
+    BATTLE_SOUNDS.die = audio.register_sound("die");
+    for (size_t i = 0; i < BATTLE_SOUNDS.slime_jump.size(); ++i)
+    {
+        BATTLE_SOUNDS.slime_jump[i] = audio.register_sound(std::format("slime{}", i).c_str());
+    }
+}
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 
+#include "../audio.hpp"
 #include "controller.hpp"
 
 enum battle_character_info_id
@@ -28,9 +30,30 @@ struct battle_character_info
     const char* hurt_sound;
     uint32_t hurt_particle_sprite_id;
 
-    using controller_factory = std::unique_ptr<bc_controller> (*)();
-    controller_factory factory;
+    controller_type controller;
     int32_t exp;
+
+    // hurt_sound, once register_battle_sounds() has run
+    sound_id hurt_sound_id = NO_SOUND;
+};
+
+extern battle_character_info B_CHARINFO[BCI_MAX];
+
+// everything else battles play
+struct battle_sound_ids
+{
+    sound_id throw_knife = NO_SOUND;
+    sound_id flash_jump = NO_SOUND;
+    sound_id avenger = NO_SOUND;
+    sound_id torch = NO_SOUND;
+    sound_id knife_draw = NO_SOUND;
+    sound_id warp = NO_SOUND;
+    sound_id die = NO_SOUND;
+    std::array<sound_id, 3> slime_jump{NO_SOUND, NO_SOUND, NO_SOUND};
 };
 
-extern battle_character_info B_CHARINFO[BCI_MAX];
\ No newline at end of file
+extern battle_sound_ids BATTLE_SOUNDS;
+
+// resolves the hurt sounds and BATTLE_SOUNDS to ids once at startup, so battles never touch a
+// sound's name. until then, and without an audio system, battles are silent.
+void register_battle_sounds(audio_system& audio);
\ No newline at end of file
@@ -1,15 +1,17 @@
 #pragma once
 
-#include <format>
 #include <glm/vec3.hpp>
 #include <vector>
 
 #include "../global_services.hpp"
+#include "../handle_pool.hpp"
 #include "../random_vec.hpp"
+#include "battle_broadphase.hpp"
 #include "battle_character.hpp"
 #include "battle_fx.hpp"
 #include "battle_particle.hpp"
 #include "battle_projectile.hpp"
+#include "encounters.hpp"
 
 struct battle_field_bounds
 {
@@ -29,10 +31,14 @@ constexpr battle_field_properties BF_SANCTUM = { "bf_sanctum", {0.2, -0.8, -0.2}
 constexpr battle_field_properties BF_LAIR    = { "bf_lair",    {0.2, -0.8, -0.2}, {0xd0 / 255.f, 0x46 / 255.f, 0x48 / 255.f } };
 // clang-format on
 
+struct battle_snapshot;
+
 struct battle_field
 {
+    static constexpr uint32_t MAX_PROJECTILES = 16384;
+
     std::vector<battle_character> characters;
-    std::vector<battle_projectile> projectiles;
+    handle_pool<battle_projectile, MAX_PROJECTILES> projectiles;
     battle_particle_system particle_sys;
     battle_fx_system fx_sys;
     battle_field_bounds bounds;
@@ -40,6 +46,20 @@ struct battle_field
     size_t player_index = SIZE_MAX;
     size_t last_enemy_hit = SIZE_MAX;
 
+    // every draw made during a battle, so the same seed replays the same battle
+    rng_stream rng;
+
+    // the enemies' controllers, indexed by character
+    battle_ai ai;
+
+    // characters are only ever added during a battle, so a handle is an index plus the battle it
+    // was made in; clear() moves on to the next one
+    uint32_t character_generation = 1;
+
+    // the player's targets, for the projectile pass
+    battle_broadphase enemy_broadphase;
+    std::vector<size_t> hit_candidates;
+
     glm::vec2 clamp_to_bounds(glm::vec2 v)
     {
         v.x = clamp(v.x, bounds.left, bounds.right);
@@ -53,22 +73,45 @@ struct battle_field
     void spawn_character(battle_character_info_id id, const glm::vec2& pos)
     {
         auto& chara = characters.emplace_back(characters.size(), &B_CHARINFO[id]);
-        if (chara.info->factory)
+        if (chara.info->controller != ct_none)
         {
-            chara.controller = chara.info->factory();
+            ai.add(chara.info->controller, static_cast<uint32_t>(characters.size() - 1), rng);
         }
         chara.pos = chara.prev_pos = pos;
     }
 
     battle_projectile& spawn_projectile(uint32_t sprite_id)
     {
-        battle_projectile& proj = projectiles.emplace_back(get_animation_set(sprite_id));
+        battle_projectile& proj = projectiles.add(get_animation_set(sprite_id));
         return proj;
     }
 
+    pool_handle character_handle(size_t index) const
+    {
+        assert(index < characters.size());
+        return {static_cast<uint32_t>(index), character_generation};
+    }
+
+    // nullptr for handles left over from an earlier battle
+    battle_character* get_character(pool_handle h)
+    {
+        if (h.generation != character_generation || h.index >= characters.size())
+        {
+            return nullptr;
+        }
+        return &characters[h.index];
+    }
+
+    const battle_character* get_character(pool_handle h) const
+    {
+        return const_cast<battle_field*>(this)->get_character(h);
+    }
+
     void clear()
     {
+        ++character_generation;
         characters.clear();
+        ai.clear();
         projectiles.clear();
         particle_sys.particles.clear();
         fx_sys.effects.clear();
@@ -77,6 +120,67 @@ struct battle_field
         last_enemy_hit = SIZE_MAX;
     }
 
+    // see battle_snapshot.hpp
+    void save_snapshot(battle_snapshot& out) const;
+    void restore_snapshot(const battle_snapshot& in);
+
+    // a fresh battle: the player on the left, enc's enemies lined up from the right
+    void begin(const encounter& enc, const battle_field_bounds& field_bounds, uint64_t seed)
+    {
+        clear();
+        bounds = field_bounds;
+        rng.seed(seed);
+
+        spawn_character(BCI_PLAYER, {bounds.left + 16, 0});
+
+        if (enc.horde_size)
+        {
+            spawn_horde(enc);
+        }
+        else
+        {
+            int32_t spawn_offset = -16;
+            for (battle_character_info_id id : enc.enemies)
+            {
+                if (id == BCI_NULL)
+                {
+                    continue;
+                }
+                spawn_character(id, {bounds.right + spawn_offset, 0});
+                spawn_offset -= 32;
+            }
+        }
+
+        set_player_index(0);
+        init_positions();
+    }
+
+    // a lineup 32 units apart runs off the field after a dozen or so, so a horde is spread evenly
+    // over all but the quarter of the field nearest the player instead, each enemy jittered within
+    // its share so they don't move in lockstep
+    void spawn_horde(const encounter& enc)
+    {
+        battle_character_info_id kinds[std::size(encounter{}.enemies)];
+        size_t kind_count = 0;
+        for (battle_character_info_id id : enc.enemies)
+        {
+            if (id != BCI_NULL)
+            {
+                kinds[kind_count++] = id;
+            }
+        }
+        assert(kind_count > 0 && "a horde needs at least one kind of enemy");
+
+        characters.reserve(characters.size() + enc.horde_size);
+
+        const float nearest = bounds.left + (bounds.right - bounds.left) * 0.25f;
+        const float share = (bounds.right - nearest) / static_cast<float>(enc.horde_size);
+        for (uint32_t i = 0; i < enc.horde_size; ++i)
+        {
+            spawn_character(kinds[i % kind_count], {nearest + share * (static_cast<float>(i) + rng.rand_real()), 0});
+        }
+    }
+
     void init_positions()
     {
         for (size_t i = 0; i < characters.size(); ++i)
@@ -87,15 +191,16 @@ struct battle_field
 
     void update(bool skip_think)
     {
+        // every think sees where everyone stood at the start of the tick
+        if (!skip_think)
+        {
+            ai.think(*this);
+        }
+
         for (size_t i = 0; i < characters.size(); ++i)
         {
             battle_character& char1 = characters[i];
 
-            if (!skip_think && char1.alive && char1.controller)
-            {
-                char1.controller->think(char1, *this);
-            }
-
             char1.update(bounds.floor);
             char1.pos.x = clamp(char1.pos.x, bounds.left, bounds.right);
 
@@ -122,8 +227,7 @@ struct battle_field
 
                 if (char1.worldspace_hitbox().intersect(player().worldspace_hitbox(), subrect))
                 {
-                    std::string hurt_sound = std::format("assets/sound/{}.ogg", player().info->hurt_sound);
-                    g_audio->play_sound(hurt_sound.c_str());
+                    g_play_sound(player().info->hurt_sound_id);
 
                     player().hitstun_frames += 60;
                     // player().vel += glm::vec2{ 2 * char1.vel.x, 0 } +glm::vec2{ 0, 3 };
@@ -131,7 +235,7 @@ struct battle_field
                     player().hurt(1);
 
                     for (int j = 0; j < 10; ++j)
-                        particle_sys.emit(player().info->hurt_particle_sprite_id, {player_hitbox.x + player_hitbox.w / 2, player_hitbox.y + player_hitbox.h / 2}, char1.vel * 0.25f + rand_vec2(-1, 1, -1, 1), 0.2f).acc = {0, -0.2f};
+                        particle_sys.emit(player().info->hurt_particle_sprite_id, {player_hitbox.x + player_hitbox.w / 2, player_hitbox.y + player_hitbox.h / 2}, char1.vel * 0.25f + rand_vec2(rng, -1, 1, -1, 1), 0.2f).acc = {0, -0.2f};
                 }
             }
 
@@ -154,6 +258,9 @@ struct battle_field
         //    c.pos.x = clamp(c.pos.x, bounds.left, bounds.right);
         //}
 
+        // characters stay put from here on, so one sort serves every projectile
+        enemy_broadphase.build(characters, player_index);
+
         for (auto& p : projectiles)
         {
             p.update(*this);
@@ -161,20 +268,30 @@ struct battle_field
             rectangle proj_rect = p.worldspace_hitbox();
             rectangle unused;
 
-            assert(p.owner != battle_projectile::INVALID_OWNER);
-            bool is_monster_owned = p.owner != player_index;
+            assert(p.owner.valid());
+            if (!get_character(p.owner))
+            {
+                p.kill();
+                continue;
+            }
+            bool is_monster_owned = p.owner.index != player_index;
 
-            for (size_t i = 0; i < characters.size(); ++i)
+            // monsters only ever hit the player
+            if (is_monster_owned)
             {
-                if (i == player_index && !is_monster_owned)
+                hit_candidates.clear();
+                if (player_index < characters.size())
                 {
-                    continue;
-                }
-                else if (i != player_index && is_monster_owned)
-                {
-                    continue;
+                    hit_candidates.push_back(player_index);
                 }
+            }
+            else
+            {
+                enemy_broadphase.query(proj_rect, hit_candidates);
+            }
 
+            for (size_t i : hit_candidates)
+            {
                 battle_character& c = characters[i];
                 rectangle char_rect = c.worldspace_hitbox();
 
@@ -185,19 +302,18 @@ struct battle_field
 
                 if (proj_rect.intersect(char_rect, unused))
                 {
-                    std::string hurt_sound = std::format("assets/sound/{}.ogg", c.info->hurt_sound);
-                    g_audio->play_sound(hurt_sound.c_str());
+                    g_play_sound(c.info->hurt_sound_id);
 
                     for (int j = 0; j < 10; ++j)
-                        particle_sys.emit(c.info->hurt_particle_sprite_id, {char_rect.x + char_rect.w / 2, char_rect.y + char_rect.h / 2}, -p.vel * 0.25f + rand_vec2(-1, 1, -1, 1), 0.2f).acc = {0, -0.2f};
+                        particle_sys.emit(c.info->hurt_particle_sprite_id, {char_rect.x + char_rect.w / 2, char_rect.y + char_rect.h / 2}, -p.vel * 0.25f + rand_vec2(rng, -1, 1, -1, 1), 0.2f).acc = {0, -0.2f};
 
                     if (proj_rect.x <= char_rect.x)
                     {
-                        fx_sys.spawn(17, right, {-12, 0}).attach(i);
+                        fx_sys.spawn(17, right, {-12, 0}).attach(character_handle(i));
                     }
                     else
                     {
-                        fx_sys.spawn(17, left, {12, 0}).attach(i);
+                        fx_sys.spawn(17, left, {12, 0}).attach(character_handle(i));
                     }
 
                     if (i == player_index)
@@ -237,13 +353,17 @@ struct battle_field
             }
         }
 
-        if (projectiles.size())
+        projectiles.remove_if([](const battle_projectile& p) {
+            return !p.alive;
+        });
+
+        // effects stuck to a character that no longer exists go with it
+        for (battle_fx& fx : fx_sys.effects)
         {
-            projectiles.erase(
-                std::remove_if(projectiles.begin(), projectiles.end(), [](const battle_projectile& p) {
-                    return !p.alive;
-                }),
-                projectiles.end());
+            if (fx.attached() && !get_character(fx.owner))
+            {
+                fx.kill();
+            }
         }
 
         particle_sys.update(bounds.floor);
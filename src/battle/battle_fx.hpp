@@ -6,19 +6,37 @@
 #include "../animation.hpp"
 #include "../animation_data.hpp"
 #include "../direction.hpp"
+#include "../handle_pool.hpp"
 
 struct battle_fx
 {
-    size_t owner = SIZE_MAX;
+    static constexpr uint32_t FOREVER = UINT32_MAX;
+
+    // a character handle from battle_field
+    pool_handle owner;
     glm::vec2 pos{}, prev_pos{}, vel{};
     animator anim;
     bool alive = true;
+    // frames left, or FOREVER
+    uint32_t life = FOREVER;
     direction dir;
 
     battle_fx(uint32_t sprite_id, direction d)
     {
         anim.set_animation_set(get_animation_set(sprite_id));
         dir = d;
+
+        // effects that end by chaining into their (empty) dead frame play once
+        const animation& a = anim.current_animation();
+        if (a.has_next && a.next == anim_dead)
+        {
+            life = a.loop_time;
+        }
+    }
+
+    void kill()
+    {
+        alive = false;
     }
 
     void update()
@@ -27,21 +45,20 @@ struct battle_fx
         pos += vel;
         anim.update();
 
-        // HACK
-        if (anim.current_name == "dead")
+        if (life != FOREVER && --life == 0)
         {
-            alive = false;
+            kill();
         }
     }
 
-    void attach(size_t owner_id)
+    void attach(pool_handle owner_handle)
     {
-        owner = owner_id;
+        owner = owner_handle;
     }
 
     bool attached() const
     {
-        return owner != SIZE_MAX;
+        return owner.valid();
     }
 
     glm::vec2 interp_pos(double a) const
@@ -58,11 +75,13 @@ struct battle_fx
 
 struct battle_fx_system
 {
-    std::vector<battle_fx> effects;
+    static constexpr uint32_t MAX_EFFECTS = 1024;
+
+    handle_pool<battle_fx, MAX_EFFECTS> effects;
 
     battle_fx& spawn(uint32_t sprite_id, direction d, glm::vec2 pos)
     {
-        auto& fx = effects.emplace_back(sprite_id, d);
+        auto& fx = effects.add(sprite_id, d);
         fx.pos = fx.prev_pos = pos;
         return fx;
     }
@@ -74,12 +93,8 @@ struct battle_fx_system
             fx.update();
         }
 
-        if (effects.size())
-        {
-            auto remove_first = std::remove_if(effects.begin(), effects.end(), [](const battle_fx& p) {
-                return !p.alive;
-            });
-            effects.erase(remove_first, effects.end());
-        }
+        effects.remove_if([](const battle_fx& fx) {
+            return !fx.alive;
+        });
     }
 };
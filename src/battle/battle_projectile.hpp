@@ -5,6 +5,7 @@
 
 #include "../animation.hpp"
 #include "../direction.hpp"
+#include "../handle_pool.hpp"
 #include "../mathutil.hpp"
 #include "../rectangle.hpp"
 
@@ -21,9 +22,8 @@ struct battle_projectile_behavior
 
 struct battle_projectile
 {
-    static constexpr size_t INVALID_OWNER = SIZE_MAX;
-
-    size_t owner = INVALID_OWNER;
+    // a character handle from battle_field
+    pool_handle owner;
 
     glm::vec2 pos, prev_pos, vel;
     animator anim;
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "battle_field.hpp"
+#include "player_kit.hpp"
+
+// Everything a battle_field simulates, for rewinding a battle, retrying it or stepping two
+// implementations side by side. All of it is trivially copyable, so saving and restoring are a
+// handful of memcpys, without allocating once the snapshot has held a battle as big. Only live
+// projectiles and effects are copied, not their pools' whole capacity, so a snapshot is as big as
+// the battle. Per-tick scratch like the broadphase is left out since update() rebuilds it. The
+// player_kit playing the battle lives outside the field; it's trivially copyable too, so keep a
+// copy next to the snapshot.
+struct battle_snapshot
+{
+    std::vector<battle_character> characters;
+    handle_pool<battle_projectile, battle_field::MAX_PROJECTILES>::saved_state projectiles;
+    std::vector<battle_particle> particles;
+    handle_pool<battle_fx, battle_fx_system::MAX_EFFECTS>::saved_state effects;
+    battle_ai ai;
+    rng_stream rng;
+
+    battle_field_bounds bounds{};
+    size_t player_index = SIZE_MAX;
+    size_t last_enemy_hit = SIZE_MAX;
+    uint32_t character_generation = 0;
+
+    // approximate heap footprint
+    size_t memory_usage() const
+    {
+        size_t bytes = characters.capacity() * sizeof(battle_character) + particles.capacity() * sizeof(battle_particle);
+        bytes += projectiles.items.capacity() * sizeof(battle_projectile) + projectiles.item_slots.capacity() * sizeof(uint32_t);
+        bytes += projectiles.slots.capacity() * sizeof(projectiles.slots[0]);
+        bytes += effects.items.capacity() * sizeof(battle_fx) + effects.item_slots.capacity() * sizeof(uint32_t);
+        bytes += effects.slots.capacity() * sizeof(effects.slots[0]);
+        return bytes;
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<battle_character>);
+static_assert(std::is_trivially_copyable_v<battle_projectile>);
+static_assert(std::is_trivially_copyable_v<battle_particle>);
+static_assert(std::is_trivially_copyable_v<battle_fx>);
+static_assert(std::is_trivially_copyable_v<slime_controller>);
+static_assert(std::is_trivially_copyable_v<skeleton_controller>);
+static_assert(std::is_trivially_copyable_v<bat_controller>);
+static_assert(std::is_trivially_copyable_v<ghost_controller>);
+static_assert(std::is_trivially_copyable_v<ragworm_controller>);
+static_assert(std::is_trivially_copyable_v<rng_stream>);
+static_assert(std::is_trivially_copyable_v<player_kit>);
+
+inline void battle_field::save_snapshot(battle_snapshot& out) const
+{
+    out.characters = characters;
+    projectiles.save(out.projectiles);
+    out.particles = particle_sys.particles;
+    fx_sys.effects.save(out.effects);
+    out.ai = ai;
+    out.rng = rng;
+    out.bounds = bounds;
+    out.player_index = player_index;
+    out.last_enemy_hit = last_enemy_hit;
+    out.character_generation = character_generation;
+}
+
+inline void battle_field::restore_snapshot(const battle_snapshot& in)
+{
+    characters = in.characters;
+    projectiles.restore(in.projectiles);
+    particle_sys.particles = in.particles;
+    fx_sys.effects.restore(in.effects);
+    ai = in.ai;
+    rng = in.rng;
+    bounds = in.bounds;
+    player_index = in.player_index;
+    last_enemy_hit = in.last_enemy_hit;
+    character_generation = in.character_generation;
+}
+
+// A hash of what a battle looks like: every character's and projectile's position, velocity and
+// state, and how many particles and effects are about. Two runs that agree on it every tick are
+// playing the same battle.
+inline uint64_t battle_digest(const battle_field& field)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    auto mix = [&h](const auto& v) {
+        unsigned char bytes[sizeof(v)];
+        std::memcpy(bytes, &v, sizeof(v));
+        for (unsigned char b : bytes)
+        {
+            h = (h ^ b) * 0x100000001b3ull;
+        }
+    };
+
+    mix(field.characters.size());
+    for (const battle_character& c : field.characters)
+    {
+        mix(c.pos);
+        mix(c.vel);
+        mix(c.life);
+        mix(c.alive);
+        mix(c.hitstun_frames);
+        mix(c.current_skill);
+        mix(c.anim.current);
+        mix(c.anim.frame_index);
+    }
+
+    mix(field.projectiles.size());
+    for (const battle_projectile& p : field.projectiles)
+    {
+        mix(p.pos);
+        mix(p.vel);
+        mix(p.alive);
+    }
+
+    mix(field.particle_sys.particles.size());
+    mix(field.fx_sys.effects.size());
+    return h;
+}
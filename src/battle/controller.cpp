@@ -1,22 +1,19 @@
 #include "controller.hpp"
 
-#include <format>
+#include <algorithm>
 
 #include "../global_services.hpp"
 #include "battle_character.hpp"
 #include "battle_field.hpp"
 
-void slime_controller::think(battle_character& self, battle_field& field)
+static void move_in(battle_character& self, direction heading)
 {
     if (!self.can_act())
     {
         return;
     }
 
-    if (jump_timer)
-        --jump_timer;
-
-    if (self.pos.x > field.player().pos.x)
+    if (heading == left)
     {
         self.move_left();
     }
@@ -24,20 +21,39 @@ void slime_controller::think(battle_character& self, battle_field& field)
     {
         self.move_right();
     }
+}
+
+void slime_controller::think(battle_character& self, battle_field& field, uint32_t ticks)
+{
+    if (!self.can_act())
+    {
+        return;
+    }
+
+    jump_timer -= std::min(jump_timer, ticks);
+
+    heading = self.pos.x > field.player().pos.x ? left : right;
+    coast(self);
 
     if (self.grounded && jump_timer == 0)
     {
-        int id = random::rand_int(0, 2);
-        std::string jump_sound = std::format("assets/sound/slime{}.ogg", id);
-        g_audio->play_sound(jump_sound.c_str());
+        int id = field.rng.rand_int(0, 2);
+        g_play_sound(BATTLE_SOUNDS.slime_jump[id]);
 
         self.jump();
-        jump_timer = random::rand_int(100, 200);
+        jump_timer = field.rng.rand_int(100, 200);
     }
 }
 
-void skeleton_controller::think(battle_character& self, battle_field& field)
+void slime_controller::coast(battle_character& self) const
+{
+    move_in(self, heading);
+}
+
+void skeleton_controller::think(battle_character& self, battle_field& field, uint32_t ticks)
 {
+    (void)ticks;
+
     if (!self.can_act())
     {
         return;
@@ -46,27 +62,13 @@ void skeleton_controller::think(battle_character& self, battle_field& field)
     // only choose a direction to move at 100 units
     if (distance(self.pos.x, self.pos.y, field.player().pos.x, field.player().pos.y) >= 100)
     {
-        if (self.pos.x > field.player().pos.x)
-        {
-            self.move_left();
-        }
-        else
-        {
-            self.move_right();
-        }
+        heading = self.pos.x > field.player().pos.x ? left : right;
     }
     else
     {
-        switch (self.facing)
-        {
-        case left:
-            self.move_left();
-            break;
-        default:
-            self.move_right();
-            break;
-        }
+        heading = self.facing == left ? left : right;
     }
+    coast(self);
 
     if (!field.player().grounded && self.grounded)
     {
@@ -74,12 +76,16 @@ void skeleton_controller::think(battle_character& self, battle_field& field)
     }
 }
 
-void bat_controller::think(battle_character& self, battle_field& field)
+void skeleton_controller::coast(battle_character& self) const
 {
-    self.set_fly_state(true);
+    move_in(self, heading);
+}
 
+void bat_controller::think(battle_character& self, battle_field& field, uint32_t ticks)
+{
     if (!self.can_act())
     {
+        self.set_fly_state(true);
         return;
     }
 
@@ -88,21 +94,17 @@ void bat_controller::think(battle_character& self, battle_field& field)
     if (st == hover)
     {
         target += glm::vec2(0, 64.f);
-        self.fly_towards(target);
         if (glm::distance(self.pos, target) >= 24.f)
         {
-            if (random::chance(0.5f))
+            if (field.rng.chance(0.5f))
             {
                 // self.fly_towards(target);
             }
         }
     }
-    else
-    {
-        self.fly_towards(target, 0.5f);
-    }
+    coast(self);
 
-    if (state_duration == 0)
+    if (state_duration < ticks)
     {
         if (st == hover)
         {
@@ -117,11 +119,11 @@ void bat_controller::think(battle_character& self, battle_field& field)
     }
     else
     {
-        --state_duration;
+        state_duration -= ticks;
     }
 }
 
-void ghost_controller::think(battle_character& self, battle_field& field)
+void bat_controller::coast(battle_character& self) const
 {
     self.set_fly_state(true);
 
@@ -130,22 +132,24 @@ void ghost_controller::think(battle_character& self, battle_field& field)
         return;
     }
 
-    if (st == rush)
-    {
-        self.fly_towards(target);
-    }
+    self.fly_towards(target, st == hover ? 1.f : 0.5f);
+}
 
-    if (glm::distance(self.pos, target) < 8.f)
+void ghost_controller::think(battle_character& self, battle_field& field, uint32_t ticks)
+{
+    if (!self.can_act())
     {
-        self.vel.x = 0;
-        self.vel.y = 0;
+        self.set_fly_state(true);
+        return;
     }
 
-    if (state_duration == 0)
+    coast(self);
+
+    if (state_duration < ticks)
     {
         if (st == idle)
         {
-            target = rand_vec2(field.bounds.left, field.bounds.right, field.bounds.floor, 64.f);
+            target = rand_vec2(field.rng, field.bounds.left, field.bounds.right, field.bounds.floor, 64.f);
             st = rush;
             state_duration = 30;
         }
@@ -157,7 +161,28 @@ void ghost_controller::think(battle_character& self, battle_field& field)
     }
     else
     {
-        --state_duration;
+        state_duration -= ticks;
+    }
+}
+
+void ghost_controller::coast(battle_character& self) const
+{
+    self.set_fly_state(true);
+
+    if (!self.can_act())
+    {
+        return;
+    }
+
+    if (st == rush)
+    {
+        self.fly_towards(target);
+    }
+
+    if (glm::distance(self.pos, target) < 8.f)
+    {
+        self.vel.x = 0;
+        self.vel.y = 0;
     }
 }
 
@@ -219,7 +244,7 @@ void ragworm_controller::think(battle_character& self, battle_field& field)
 
         if (frames_walking == 60)
         {
-            self.use_skill(field, &sk_teleport);
+            self.use_skill(field, sk_teleport);
             st = exhausted;
             exhaust_timer = 30;
         }
@@ -229,28 +254,122 @@ void ragworm_controller::think(battle_character& self, battle_field& field)
         int choice;
         do
         {
-            choice = random::rand_int(0, 3);
+            choice = field.rng.rand_int(0, 3);
         } while (choice == last_choice);
         last_choice = choice;
 
         switch (choice)
         {
         case 0:
-            self.use_skill(field, &sk_meteor);
+            self.use_skill(field, sk_meteor);
             break;
         case 1:
-            self.use_skill(field, &sk_burst);
+            self.use_skill(field, sk_burst);
             break;
         case 2:
-            self.use_skill(field, &sk_teleport);
+            self.use_skill(field, sk_teleport);
             break;
         case 3:
             st = walk_towards_player;
             frames_walking = 0;
             walk_target = field.player().pos;
             walk_target.y = field.bounds.floor;
-            g_audio->play_sound("assets/sound/die.ogg");
+            g_play_sound(BATTLE_SOUNDS.die);
             break;
         }
     }
-}
\ No newline at end of file
+}
+
+void battle_ai::clear()
+{
+    slimes.clear();
+    skeletons.clear();
+    bats.clear();
+    ghosts.clear();
+    ragworms.clear();
+    tick = 0;
+    cursor = 0;
+}
+
+void battle_ai::add(controller_type type, uint32_t owner, rng_stream& rng)
+{
+    switch (type)
+    {
+    case ct_none:
+        break;
+    case ct_slime:
+        slimes.emplace_back(owner, rng);
+        break;
+    case ct_skeleton:
+        skeletons.emplace_back(owner);
+        break;
+    case ct_bat:
+        bats.emplace_back(owner);
+        break;
+    case ct_ghost:
+        ghosts.emplace_back(owner);
+        break;
+    case ct_ragworm:
+        ragworms.emplace_back(owner);
+        break;
+    }
+}
+
+void battle_ai::set_think_budget(uint32_t budget)
+{
+    assert(budget > 0);
+    think_budget = budget;
+}
+
+template <typename C>
+void battle_ai::think_group(std::vector<C>& group, battle_field& field, uint32_t& slot, uint32_t slots)
+{
+    for (C& c : group)
+    {
+        // the budget's worth of slots from the cursor on, wrapping around
+        const bool thinks = slots <= think_budget || (slot + slots - cursor) % slots < think_budget;
+        ++slot;
+
+        battle_character& self = field.characters[c.owner];
+        if (!self.alive)
+        {
+            continue;
+        }
+
+        if (thinks)
+        {
+            c.think(self, field, tick - c.last_think);
+            c.last_think = tick;
+        }
+        else
+        {
+            c.coast(self);
+        }
+    }
+}
+
+void battle_ai::think(battle_field& field)
+{
+    ++tick;
+
+    const uint32_t slots = static_cast<uint32_t>(slimes.size() + skeletons.size() + bats.size() + ghosts.size());
+    uint32_t slot = 0;
+    think_group(slimes, field, slot, slots);
+    think_group(skeletons, field, slot, slots);
+    think_group(bats, field, slot, slots);
+    think_group(ghosts, field, slot, slots);
+
+    for (ragworm_controller& c : ragworms)
+    {
+        battle_character& self = field.characters[c.owner];
+        if (self.alive)
+        {
+            c.think(self, field);
+        }
+    }
+
+    if (slots > think_budget)
+    {
+        cursor = (cursor + think_budget) % slots;
+    }
+}
@@ -2,7 +2,7 @@
 
 #include <cstdint>
 #include <glm/vec2.hpp>
-#include <memory>
+#include <vector>
 
 #include "../direction.hpp"
 #include "../random.hpp"
@@ -11,37 +11,52 @@
 struct battle_character;
 struct battle_field;
 
+enum controller_type : uint8_t
+{
+    ct_none,
+    ct_slime,
+    ct_skeleton,
+    ct_bat,
+    ct_ghost,
+    ct_ragworm,
+};
+
+// think() makes a controller's decisions and steers. ticks is how many ticks it covers, which is
+// more than one when battle_ai spreads thinks out; coast() keeps the character doing what the
+// last think decided on the ticks in between.
 struct bc_controller
 {
-    virtual ~bc_controller() {}
-    virtual void think(battle_character& self, battle_field& field) = 0;
+    // index into battle_field::characters
+    uint32_t owner = 0;
+    uint32_t last_think = 0;
 };
 
 struct slime_controller : bc_controller
 {
     uint32_t jump_timer;
+    direction heading = left;
 
-    void think(battle_character& self, battle_field& field);
-
-    slime_controller()
+    slime_controller(uint32_t owner_index, rng_stream& rng)
     {
-        jump_timer = random::rand_int(100, 200);
+        owner = owner_index;
+        jump_timer = rng.rand_int(100, 200);
     }
 
-    static std::unique_ptr<bc_controller> create()
-    {
-        return std::make_unique<slime_controller>();
-    }
+    void think(battle_character& self, battle_field& field, uint32_t ticks);
+    void coast(battle_character& self) const;
 };
 
 struct skeleton_controller : bc_controller
 {
-    void think(battle_character& self, battle_field& field);
+    direction heading = left;
 
-    static std::unique_ptr<bc_controller> create()
+    explicit skeleton_controller(uint32_t owner_index)
     {
-        return std::make_unique<skeleton_controller>();
+        owner = owner_index;
     }
+
+    void think(battle_character& self, battle_field& field, uint32_t ticks);
+    void coast(battle_character& self) const;
 };
 
 struct bat_controller : bc_controller
@@ -57,12 +72,13 @@ struct bat_controller : bc_controller
 
     state st = chase;
 
-    void think(battle_character& self, battle_field& field);
-
-    static std::unique_ptr<bc_controller> create()
+    explicit bat_controller(uint32_t owner_index)
     {
-        return std::make_unique<bat_controller>();
+        owner = owner_index;
     }
+
+    void think(battle_character& self, battle_field& field, uint32_t ticks);
+    void coast(battle_character& self) const;
 };
 
 struct ghost_controller : bc_controller
@@ -78,12 +94,13 @@ struct ghost_controller : bc_controller
 
     state st = idle;
 
-    void think(battle_character& self, battle_field& field);
-
-    static std::unique_ptr<bc_controller> create()
+    explicit ghost_controller(uint32_t owner_index)
     {
-        return std::make_unique<ghost_controller>();
+        owner = owner_index;
     }
+
+    void think(battle_character& self, battle_field& field, uint32_t ticks);
+    void coast(battle_character& self) const;
 };
 
 struct ragworm_controller : bc_controller
@@ -105,10 +122,48 @@ struct ragworm_controller : bc_controller
     int last_choice = -1;
     bool could_act_last_frame = true;
 
+    explicit ragworm_controller(uint32_t owner_index)
+    {
+        owner = owner_index;
+    }
+
+    // its skills need updating every tick, so a ragworm always thinks
     void think(battle_character& self, battle_field& field);
+};
+
+// Every enemy's controller, stored by type so thinking is one pass over a plain array per type
+// rather than a virtual call per character. Up to the think budget, every controller thinks every
+// tick. Beyond it, each tick the next budget's worth in round-robin order think, catching up on
+// the ticks they missed, and the rest coast.
+class battle_ai
+{
+public:
+    static constexpr uint32_t DEFAULT_THINK_BUDGET = 32;
 
-    static std::unique_ptr<bc_controller> create()
+    void clear();
+    void add(controller_type type, uint32_t owner, rng_stream& rng);
+
+    void set_think_budget(uint32_t budget);
+
+    // once per tick, before characters move
+    void think(battle_field& field);
+
+    size_t size() const
     {
-        return std::make_unique<ragworm_controller>();
+        return slimes.size() + skeletons.size() + bats.size() + ghosts.size() + ragworms.size();
     }
-};
\ No newline at end of file
+
+private:
+    template <typename C>
+    void think_group(std::vector<C>& group, battle_field& field, uint32_t& slot, uint32_t slots);
+
+    std::vector<slime_controller> slimes;
+    std::vector<skeleton_controller> skeletons;
+    std::vector<bat_controller> bats;
+    std::vector<ghost_controller> ghosts;
+    std::vector<ragworm_controller> ragworms;
+
+    uint32_t think_budget = DEFAULT_THINK_BUDGET;
+    uint32_t tick = 0;
+    uint32_t cursor = 0;
+};
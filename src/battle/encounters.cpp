@@ -33,7 +33,7 @@ encounter_set enc_lair{
 
 const encounter& encounter_set::random_encounter() const
 {
-    size_t i = (size_t)random::rand_int(0, (int)encounters.size() - 1);
+    size_t i = (size_t)get_rng(rng_encounters).rand_int(0, (int)encounters.size() - 1);
     return encounters[i];
 }
 
@@ -56,4 +56,9 @@ const encounter_set& get_encounter_set(uint32_t id)
 encounter get_final_boss_encounter()
 {
     return {{BCI_RAGWORM, BCI_NULL, BCI_NULL, BCI_NULL, BCI_NULL, BCI_NULL, BCI_NULL, BCI_NULL}};
+}
+
+encounter get_horde_encounter(uint32_t count)
+{
+    return {{BCI_SLIME, BCI_SKELETON, BCI_BAT, BCI_GHOST, BCI_SLIME, BCI_SPIDER, BCI_NULL, BCI_NULL}, count};
 }
\ No newline at end of file
@@ -9,9 +9,13 @@ struct encounter
 {
     battle_character_info_id enemies[8];
 
+    // when nonzero, a horde of this many enemies taking turns from enemies instead of the lineup
+    // itself, spread out over the field
+    uint32_t horde_size = 0;
+
     bool operator==(const encounter& rhs) const
     {
-        return std::equal(std::cbegin(enemies), std::cend(enemies), std::cbegin(rhs.enemies), std::cend(rhs.enemies));
+        return horde_size == rhs.horde_size && std::equal(std::cbegin(enemies), std::cend(enemies), std::cbegin(rhs.enemies), std::cend(rhs.enemies));
     }
 };
 
@@ -23,4 +27,7 @@ struct encounter_set
 };
 
 const encounter_set& get_encounter_set(uint32_t id);
-encounter get_final_boss_encounter();
\ No newline at end of file
+encounter get_final_boss_encounter();
+
+// count enemies of every kind but the ragworm, for finding how many a battle can take
+encounter get_horde_encounter(uint32_t count);
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+
+#include "battle_field.hpp"
+#include "skill.hpp"
+
+// The player's skills and the shadow partner that repeats them a moment later. Whatever drives a
+// battle_field, st_battle's key handling or battle_sim's policies, plays the player through this.
+struct player_kit
+{
+    // 0.1s at the game's update rate
+    static constexpr uint32_t SHADOW_ECHO_TICKS = 3;
+
+    bool has_flashjump = false;
+    bool has_avenger = false;
+    bool has_shadowpartner = false;
+
+    sk_flash_jump flash_jump;
+    sk_double_throw double_throw;
+    sk_avenger avenger;
+
+    sk_double_throw shadow_double_throw;
+    sk_avenger shadow_avenger;
+    // what the shadow partner throws next, from shadow_double_throw or shadow_avenger
+    skill_id shadow_echo = skill_none;
+    uint32_t shadow_echo_ticks = 0;
+
+    void jump(battle_field& field)
+    {
+        field.player().jump();
+        if (has_flashjump)
+        {
+            field.player().use_skill(field, flash_jump);
+        }
+    }
+
+    void throw_knives(battle_field& field)
+    {
+        field.player().use_skill(field, double_throw);
+        echo(skill_double_throw);
+    }
+
+    void throw_avenger(battle_field& field)
+    {
+        if (!has_avenger)
+        {
+            return;
+        }
+        field.player().use_skill(field, avenger);
+        echo(skill_avenger);
+    }
+
+    // once per tick, after battle_field::update
+    void update(battle_field& field)
+    {
+        battle_character& player = field.player();
+        flash_jump.update(field, player);
+        double_throw.update(field, player);
+        avenger.update(field, player);
+
+        shadow_double_throw.update(field, player);
+        shadow_avenger.update(field, player);
+
+        if (shadow_echo != skill_none && --shadow_echo_ticks == 0)
+        {
+            if (shadow_echo == skill_double_throw)
+            {
+                player.use_skill_unconditionally(field, shadow_double_throw);
+            }
+            else
+            {
+                player.use_skill_unconditionally(field, shadow_avenger);
+            }
+            shadow_echo = skill_none;
+        }
+    }
+
+private:
+    void echo(skill_id id)
+    {
+        if (has_shadowpartner)
+        {
+            shadow_echo = id;
+            shadow_echo_ticks = SHADOW_ECHO_TICKS;
+        }
+    }
+};
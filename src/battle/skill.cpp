@@ -7,9 +7,9 @@ void bpb_avenger_update(battle_field& field, battle_projectile& self)
 {
     for (int i = 0; i < 4; ++i)
     {
-        if (random::chance(0.25f))
+        if (field.rng.chance(0.25f))
         {
-            field.particle_sys.emit(25, self.pos, -self.vel * 0.4f + rand_vec2(-1, 1), 1.f);
+            field.particle_sys.emit(25, self.pos, -self.vel * 0.4f + rand_vec2(field.rng, -1, 1), 1.f);
         }
     }
 }
@@ -35,7 +35,7 @@ void sk_double_throw::use(battle_field& field, battle_character& owner)
         spawn_offset.x = 16;
     }
 
-    field.fx_sys.spawn(15, owner.facing, spawn_offset).attach(field.player_index);
+    field.fx_sys.spawn(15, owner.facing, spawn_offset).attach(field.character_handle(field.player_index));
 }
 
 void sk_double_throw::update(battle_field& field, battle_character& owner)
@@ -57,7 +57,7 @@ void sk_double_throw::spawn_projectile(battle_field& field, battle_character& ow
 
     battle_projectile& p = field.spawn_projectile(14);
     p.prev_pos = p.pos = owner.pos;
-    p.owner = owner.id;
+    p.owner = field.character_handle(owner.id);
     p.pierce = 0;
     p.dir = use_direction;
     p.angle_to_velocity = true;
@@ -73,10 +73,10 @@ void sk_double_throw::spawn_projectile(battle_field& field, battle_character& ow
         p.vel = {5, 0.5};
     }
 
-    g_audio->play_sound("assets/sound/throw1.ogg");
+    g_play_sound(BATTLE_SOUNDS.throw_knife);
 }
 
-bool sk_flash_jump::can_use(battle_character& owner) const
+bool sk_flash_jump::can_use(const battle_character& owner) const
 {
     return !owner.grounded && owner.frames_since_jump >= 3 && remaining > 0;
 }
@@ -85,7 +85,7 @@ void sk_flash_jump::use(battle_field& field, battle_character& owner)
 {
     --remaining;
 
-    g_audio->play_sound("assets/sound/flashjump.ogg");
+    g_play_sound(BATTLE_SOUNDS.flash_jump);
 
     switch (owner.facing)
     {
@@ -133,7 +133,7 @@ void sk_avenger::update(battle_field& field, battle_character& owner)
     {
         if (windup_counter % 2 == 0)
         {
-            field.particle_sys.emit(25, owner.pos, rand_vec2(-2, 2), 1.f);
+            field.particle_sys.emit(25, owner.pos, rand_vec2(field.rng, -2, 2), 1.f);
         }
 
         --windup_counter;
@@ -143,7 +143,7 @@ void sk_avenger::update(battle_field& field, battle_character& owner)
     {
         battle_projectile& p = field.spawn_projectile(19);
         p.prev_pos = p.pos = owner.pos;
-        p.owner = owner.id;
+        p.owner = field.character_handle(owner.id);
         p.pierce = 999999;
         p.behavior = &bpb_avenger;
         if (owner.facing == left)
@@ -165,7 +165,7 @@ void sk_avenger::use(battle_field& field, battle_character& owner)
     (void)field;
     (void)owner;
 
-    g_audio->play_sound("assets/sound/avenger.ogg");
+    g_play_sound(BATTLE_SOUNDS.avenger);
     windup_counter = 15;
     thrown = false;
 }
@@ -175,19 +175,19 @@ void ragworm_meteor::use(battle_field& field, battle_character& owner)
     for (int i = 0; i < 10; ++i)
     {
         auto& p = field.spawn_projectile(13);
-        p.prev_pos = p.pos = rand_vec2(field.bounds.left, field.bounds.right, 100, 200);
-        p.vel = {0, -1.0 - random::rand_real()};
-        p.owner = owner.id;
+        p.prev_pos = p.pos = rand_vec2(field.rng, field.bounds.left, field.bounds.right, 100, 200);
+        p.vel = {0, -1.0 - field.rng.rand_real()};
+        p.owner = field.character_handle(owner.id);
     }
 
-    g_audio->play_sound("assets/sound/torch.ogg");
+    g_play_sound(BATTLE_SOUNDS.torch);
 }
 
 void ragworm_meteor::update(battle_field& field, battle_character& owner)
 {
-    if (owner.current_skill == this)
+    if (owner.current_skill == ID)
     {
-        field.particle_sys.emit(13, owner.pos, rand_vec2(-1, 1, 0, 2), 1.f);
+        field.particle_sys.emit(13, owner.pos, rand_vec2(field.rng, -1, 1, 0, 2), 1.f);
     }
 }
 
@@ -202,7 +202,7 @@ void bpb_burst_update(battle_field& field, battle_projectile& self)
     }
     if (self.pierce == 30)
     {
-        g_audio->play_sound("assets/sound/knifedraw.ogg");
+        g_play_sound(BATTLE_SOUNDS.knife_draw);
         self.vel = field.player().pos - self.pos;
         self.vel = glm::normalize(self.vel);
     }
@@ -234,12 +234,12 @@ void ragworm_burst::update(battle_field& field, battle_character& owner)
     auto& p = field.spawn_projectile(24);
     p.behavior = &bpb_burst;
     p.prev_pos = p.pos = owner.pos;
-    p.vel = {random::rand_real(-0.5, 0.5), 2.5f};
-    p.owner = owner.id;
+    p.vel = {field.rng.rand_real(-0.5, 0.5), 2.5f};
+    p.owner = field.character_handle(owner.id);
     p.angle_to_velocity = true;
     p.pierce = 0;
 
-    g_audio->play_sound("assets/sound/throw1.ogg");
+    g_play_sound(BATTLE_SOUNDS.throw_knife);
 }
 
 void ragworm_teleport::use(battle_field& field, battle_character& owner)
@@ -250,15 +250,15 @@ void ragworm_teleport::use(battle_field& field, battle_character& owner)
     do
     {
         dst = {
-            (field.bounds.left + field.bounds.right) / 2 + random::rand_real(-100, 100),
-            random::rand_real(field.bounds.floor, field.bounds.floor + 32)};
+            (field.bounds.left + field.bounds.right) / 2 + field.rng.rand_real(-100, 100),
+            field.rng.rand_real(field.bounds.floor, field.bounds.floor + 32)};
     } while (glm::distance(dst, field.player().pos) < 32.f);
 
     field.fx_sys.spawn(18, right, src);
     field.fx_sys.spawn(18, right, dst);
     owner.warp(dst);
 
-    g_audio->play_sound("assets/sound/warpspell.ogg");
+    g_play_sound(BATTLE_SOUNDS.warp);
 }
 
 void ragworm_teleport::update(battle_field& field, battle_character& owner)
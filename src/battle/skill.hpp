@@ -1,107 +1,91 @@
 #pragma once
 
 #include <cstdint>
-#include <string>
 
 #include "../direction.hpp"
 
 struct battle_field;
 struct battle_character;
 
-struct skill
+enum skill_id : uint8_t
 {
-    virtual std::string name() const = 0;
-    virtual uint32_t cooldown() const = 0;
-    virtual uint32_t cast_time() const = 0;
-
-    virtual void update(battle_field& field, battle_character& owner) = 0;
-    virtual bool can_use(battle_character& owner) const = 0;
-    virtual void use(battle_field& field, battle_character& owner) = 0;
+    skill_none,
+    skill_flash_jump,
+    skill_avenger,
+    skill_double_throw,
+    skill_ragworm_meteor,
+    skill_ragworm_burst,
+    skill_ragworm_teleport,
+
+    SKILL_ID_COUNT
 };
 
-struct sk_flash_jump : public skill
+struct skill_info
 {
-    std::string name() const override
-    {
-        return "Flash Jump";
-    }
-
-    uint32_t cooldown() const override
-    {
-        return 0;
-    }
+    const char* name;
+    uint32_t cooldown;
+    uint32_t cast_time;
+};
 
-    uint32_t cast_time() const override
-    {
-        return 0;
-    }
+// clang-format off
+constexpr skill_info SKILL_INFO[SKILL_ID_COUNT]{
+    {"",             0,      0},
+    {"Flash Jump",   0,      0},
+    {"Avenger",      0,      30},
+    {"Double Throw", 0,      12},
+    {"meteor",       30 * 5, 30 * 5},
+    {"burst",        30 * 5, 90},
+    {"teleport",     0,      0},
+};
+// clang-format on
 
-    virtual bool can_use(battle_character& owner) const override;
+// Skills are plain state kept by value by whoever has them (player_kit, ragworm_controller), so a
+// battle can be copied. A character casting one only remembers its id. Each skill has:
+//     static constexpr skill_id ID;
+//     bool can_use(const battle_character& owner) const;
+//     void use(battle_field& field, battle_character& owner);
+//     void update(battle_field& field, battle_character& owner);
 
-    virtual void use(battle_field& field, battle_character& owner) override;
+struct sk_flash_jump
+{
+    static constexpr skill_id ID = skill_flash_jump;
 
-    virtual void update(battle_field& field, battle_character& owner) override;
+    bool can_use(const battle_character& owner) const;
+    void use(battle_field& field, battle_character& owner);
+    void update(battle_field& field, battle_character& owner);
 
     uint32_t remaining = 0;
 };
 
-struct sk_avenger : public skill
+struct sk_avenger
 {
-    std::string name() const override
-    {
-        return "Avenger";
-    }
+    static constexpr skill_id ID = skill_avenger;
 
-    uint32_t cooldown() const override
-    {
-        return 0;
-    }
-
-    uint32_t cast_time() const override
-    {
-        return 30;
-    }
-
-    virtual bool can_use(battle_character& owner) const override
+    bool can_use(const battle_character& owner) const
     {
         (void)owner;
         return true;
     }
 
-    virtual void use(battle_field& field, battle_character& owner) override;
-
-    virtual void update(battle_field& field, battle_character& owner) override;
+    void use(battle_field& field, battle_character& owner);
+    void update(battle_field& field, battle_character& owner);
 
     uint32_t windup_counter = 0;
     bool thrown = true;
 };
 
-struct sk_double_throw : public skill
+struct sk_double_throw
 {
-    std::string name() const override
-    {
-        return "Double Throw";
-    }
+    static constexpr skill_id ID = skill_double_throw;
 
-    uint32_t cooldown() const override
-    {
-        return 0;
-    }
-
-    uint32_t cast_time() const override
-    {
-        return 12;
-    }
-
-    virtual bool can_use(battle_character& owner) const override
+    bool can_use(const battle_character& owner) const
     {
         (void)owner;
         return true;
     }
 
-    virtual void use(battle_field& field, battle_character& owner) override;
-
-    virtual void update(battle_field& field, battle_character& owner) override;
+    void use(battle_field& field, battle_character& owner);
+    void update(battle_field& field, battle_character& owner);
 
     void spawn_projectile(battle_field& field, battle_character& owner, bool primary);
 
@@ -110,87 +94,46 @@ struct sk_double_throw : public skill
     direction use_direction = left;
 };
 
-struct ragworm_meteor : public skill
+struct ragworm_meteor
 {
-    std::string name() const override
-    {
-        return "meteor";
-    }
-
-    uint32_t cooldown() const override
-    {
-        return 30 * 5;
-    }
-
-    uint32_t cast_time() const override
-    {
-        return 30 * 5;
-    }
+    static constexpr skill_id ID = skill_ragworm_meteor;
 
-    virtual bool can_use(battle_character& owner) const override
+    bool can_use(const battle_character& owner) const
     {
         (void)owner;
         return true;
     }
 
-    virtual void use(battle_field& field, battle_character& owner) override;
-
-    virtual void update(battle_field& field, battle_character& owner) override;
+    void use(battle_field& field, battle_character& owner);
+    void update(battle_field& field, battle_character& owner);
 };
 
-struct ragworm_burst : public skill
+struct ragworm_burst
 {
-    uint32_t knives = 0;
-
-    std::string name() const override
-    {
-        return "burst";
-    }
-
-    uint32_t cooldown() const override
-    {
-        return 30 * 5;
-    }
+    static constexpr skill_id ID = skill_ragworm_burst;
 
-    uint32_t cast_time() const override
-    {
-        return 90;
-    }
+    uint32_t knives = 0;
 
-    virtual bool can_use(battle_character& owner) const override
+    bool can_use(const battle_character& owner) const
     {
         (void)owner;
         return true;
     }
 
-    virtual void use(battle_field& field, battle_character& owner) override;
-    virtual void update(battle_field& field, battle_character& owner) override;
+    void use(battle_field& field, battle_character& owner);
+    void update(battle_field& field, battle_character& owner);
 };
 
-struct ragworm_teleport : public skill
+struct ragworm_teleport
 {
+    static constexpr skill_id ID = skill_ragworm_teleport;
 
-    std::string name() const override
-    {
-        return "teleport";
-    }
-
-    uint32_t cooldown() const override
-    {
-        return 0;
-    }
-
-    uint32_t cast_time() const override
-    {
-        return 0;
-    }
-
-    virtual bool can_use(battle_character& owner) const override
+    bool can_use(const battle_character& owner) const
     {
         (void)owner;
         return true;
     }
 
-    virtual void use(battle_field& field, battle_character& owner) override;
-    virtual void update(battle_field& field, battle_character& owner) override;
+    void use(battle_field& field, battle_character& owner);
+    void update(battle_field& field, battle_character& owner);
 };
\ No newline at end of file
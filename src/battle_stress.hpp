@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <print>
+
+#include "battle/battle_field.hpp"
+
+// Drives st_battle under --battle-stress: ever bigger hordes, FIRST_HORDE enemies doubling each
+// stage, with what every stage cost logged as it ends. It stops after LAST_HORDE, or after the
+// first stage where an average tick and frame together take longer than a tick lasts, since from
+// there on the game can't keep its frame rate.
+class battle_stress
+{
+public:
+    static constexpr uint32_t FIRST_HORDE = 16;
+    static constexpr uint32_t LAST_HORDE = 8192;
+
+    // 10s at the game's update rate
+    static constexpr uint32_t STAGE_TICKS = 300;
+    static constexpr double TICK_BUDGET_MS = 1000.0 / 30;
+
+    uint32_t horde_size() const
+    {
+        return horde;
+    }
+
+    bool finished() const
+    {
+        return done;
+    }
+
+    void record_tick(double ms, const battle_field& field)
+    {
+        ++ticks;
+        tick_ms.add(ms);
+        particles.add(static_cast<double>(field.particle_sys.particles.size()));
+        projectiles.add(static_cast<double>(field.projectiles.size()));
+        effects.add(static_cast<double>(field.fx_sys.effects.size()));
+    }
+
+    // rendering and waiting for the gpu to finish
+    void record_frame(double ms)
+    {
+        frame_ms.add(ms);
+    }
+
+    // true once the stage has run its course, after logging it and moving on to the next
+    bool end_stage()
+    {
+        if (ticks < STAGE_TICKS)
+        {
+            return false;
+        }
+
+        std::println("horde {:5}: tick {:.2f}ms (max {:.2f}ms)  frame {:.2f}ms (max {:.2f}ms)  particles {:.0f} (max {:.0f})  projectiles {:.0f} (max {:.0f})  fx {:.0f} (max {:.0f})", horde, tick_ms.mean(), tick_ms.max, frame_ms.mean(), frame_ms.max, particles.mean(), particles.max, projectiles.mean(), projectiles.max, effects.mean(), effects.max);
+
+        if (tick_ms.mean() + frame_ms.mean() > TICK_BUDGET_MS)
+        {
+            std::println("the battle no longer keeps up at {} enemies", horde);
+            done = true;
+        }
+        else if (horde >= LAST_HORDE)
+        {
+            std::println("the battle kept up all the way to {} enemies", horde);
+            done = true;
+        }
+
+        horde *= 2;
+        ticks = 0;
+        tick_ms = {};
+        frame_ms = {};
+        particles = {};
+        projectiles = {};
+        effects = {};
+        return true;
+    }
+
+private:
+    struct sample
+    {
+        double total = 0;
+        double max = 0;
+        uint32_t count = 0;
+
+        void add(double v)
+        {
+            total += v;
+            max = std::max(max, v);
+            ++count;
+        }
+
+        double mean() const
+        {
+            return count ? total / count : 0;
+        }
+    };
+
+    uint32_t horde = FIRST_HORDE;
+    uint32_t ticks = 0;
+    bool done = false;
+
+    sample tick_ms;
+    sample frame_ms;
+    sample particles;
+    sample projectiles;
+    sample effects;
+};
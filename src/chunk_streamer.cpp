@@ -0,0 +1,221 @@
+#include "chunk_streamer.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+chunk_streamer::chunk_streamer()
+{
+    worker = std::thread([this]() { run(); });
+}
+
+chunk_streamer::~chunk_streamer()
+{
+    {
+        std::scoped_lock lk(m);
+        quit = true;
+    }
+    queue_cv.notify_one();
+    worker.join();
+}
+
+void chunk_streamer::set_residency_radius(uint32_t chunks)
+{
+    radius = chunks;
+}
+
+void chunk_streamer::attach(tilemap* to)
+{
+    if (map)
+    {
+        for (uint32_t c : resident)
+        {
+            evict(c);
+        }
+    }
+    resident.clear();
+    states.clear();
+    chunks_w = chunks_h = 0;
+
+    map = to && to->base.is_chunked() ? to : nullptr;
+    if (map)
+    {
+        chunks_w = (map->width + CHUNK_TILES - 1) / CHUNK_TILES;
+        chunks_h = (map->height + CHUNK_TILES - 1) / CHUNK_TILES;
+        states.assign(map->base.chunk_count(), cs_absent);
+    }
+
+    std::scoped_lock lk(m);
+    ++generation;
+    queue.clear();
+    finished.clear();
+    source = map ? std::make_shared<const layer_set>(layer_set{map->base, map->detail, map->fringe}) : nullptr;
+}
+
+void chunk_streamer::update(const rectangle& view)
+{
+    if (!map)
+    {
+        return;
+    }
+
+    constexpr int CHUNK_PIXELS = CHUNK_TILES * 16;
+    const int r = static_cast<int>(radius);
+    const int view_min_cx = std::max(view.left(), 0) / CHUNK_PIXELS;
+    const int view_min_cy = std::max(view.top(), 0) / CHUNK_PIXELS;
+    const int view_max_cx = std::max(view.right(), 0) / CHUNK_PIXELS;
+    const int view_max_cy = std::max(view.bottom(), 0) / CHUNK_PIXELS;
+
+    // chunks within slack of the wanted area are kept, so walking back and forth over a chunk
+    // border doesn't decode the same chunks over and over
+    auto within = [&](uint32_t c, int slack) {
+        int cx = static_cast<int>(c % chunks_w);
+        int cy = static_cast<int>(c / chunks_w);
+        return cx >= view_min_cx - r - slack && cx <= view_max_cx + r + slack && cy >= view_min_cy - r - slack && cy <= view_max_cy + r + slack;
+    };
+
+    std::vector<decoded_chunk> done;
+    {
+        std::scoped_lock lk(m);
+        done.swap(finished);
+
+        // no point decoding what we've walked away from in the meantime
+        std::erase_if(queue, [&](uint32_t c) {
+            if (within(c, 0))
+            {
+                return false;
+            }
+            states[c] = cs_absent;
+            return true;
+        });
+    }
+
+    for (decoded_chunk& d : done)
+    {
+        if (states[d.index] != cs_pending)
+        {
+            continue;
+        }
+
+        if (!within(d.index, 1))
+        {
+            states[d.index] = cs_absent;
+            continue;
+        }
+
+        tile_layer* layers[] = {&map->base, &map->detail, &map->fringe};
+        for (size_t i = 0; i < 3; ++i)
+        {
+            if (d.layers[i])
+            {
+                layers[i]->install_chunk(d.index, std::move(d.layers[i]));
+            }
+        }
+        states[d.index] = cs_resident;
+        resident.push_back(d.index);
+    }
+
+    std::erase_if(resident, [&](uint32_t c) {
+        if (within(c, 1))
+        {
+            return false;
+        }
+        evict(c);
+        return true;
+    });
+
+    // queue what's missing, closest to the view first
+    std::vector<uint32_t> missing;
+    const int min_cx = std::max(view_min_cx - r, 0);
+    const int min_cy = std::max(view_min_cy - r, 0);
+    const int max_cx = std::min(view_max_cx + r, static_cast<int>(chunks_w) - 1);
+    const int max_cy = std::min(view_max_cy + r, static_cast<int>(chunks_h) - 1);
+    for (int cy = min_cy; cy <= max_cy; ++cy)
+    {
+        for (int cx = min_cx; cx <= max_cx; ++cx)
+        {
+            uint32_t c = cy * chunks_w + cx;
+            if (states[c] == cs_absent)
+            {
+                missing.push_back(c);
+            }
+        }
+    }
+
+    if (missing.empty())
+    {
+        return;
+    }
+
+    const int center_cx = (view_min_cx + view_max_cx) / 2;
+    const int center_cy = (view_min_cy + view_max_cy) / 2;
+    auto distance = [&](uint32_t c) {
+        return std::abs(static_cast<int>(c % chunks_w) - center_cx) + std::abs(static_cast<int>(c / chunks_w) - center_cy);
+    };
+    std::sort(missing.begin(), missing.end(), [&](uint32_t a, uint32_t b) {
+        return distance(a) < distance(b);
+    });
+
+    {
+        std::scoped_lock lk(m);
+        for (uint32_t c : missing)
+        {
+            states[c] = cs_pending;
+            queue.push_back(c);
+        }
+    }
+    queue_cv.notify_one();
+}
+
+void chunk_streamer::evict(uint32_t c)
+{
+    map->base.evict_chunk(c);
+    if (map->detail.is_chunked())
+    {
+        map->detail.evict_chunk(c);
+    }
+    if (map->fringe.is_chunked())
+    {
+        map->fringe.evict_chunk(c);
+    }
+    states[c] = cs_absent;
+}
+
+void chunk_streamer::run()
+{
+    while (true)
+    {
+        uint32_t c;
+        uint32_t gen;
+        std::shared_ptr<const layer_set> layers;
+        {
+            std::unique_lock<std::mutex> lk(m);
+            queue_cv.wait(lk, [&]() { return quit || queue.size(); });
+
+            if (quit)
+            {
+                return;
+            }
+
+            c = queue.front();
+            queue.pop_front();
+            gen = generation;
+            layers = source;
+        }
+
+        decoded_chunk d{gen, c, {}};
+        for (size_t i = 0; i < 3; ++i)
+        {
+            if ((*layers)[i].is_chunked())
+            {
+                d.layers[i] = std::make_unique<tile[]>(CHUNK_AREA);
+                (*layers)[i].decode_chunk(c, {d.layers[i].get(), CHUNK_AREA});
+            }
+        }
+
+        std::scoped_lock lk(m);
+        if (gen == generation)
+        {
+            finished.push_back(std::move(d));
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rectangle.hpp"
+#include "tilemap.hpp"
+
+// Keeps the chunks of a chunked16 map decoded around the camera. Chunks within the residency
+// radius of the view are decoded on a worker thread and installed by update(); chunks that fall
+// further out are dropped again. Maps that aren't chunked are left alone.
+class chunk_streamer
+{
+public:
+    static constexpr uint32_t DEFAULT_RESIDENCY_RADIUS = 2;
+
+    chunk_streamer();
+    ~chunk_streamer();
+
+    chunk_streamer(const chunk_streamer&) = delete;
+    chunk_streamer& operator=(const chunk_streamer&) = delete;
+
+    // in chunks around those overlapping the view
+    void set_residency_radius(uint32_t chunks);
+
+    // starts streaming map, dropping everything decoded for the previous one. pass nullptr
+    // before the current map is moved or destroyed.
+    void attach(tilemap* map);
+
+    // installs finished chunks, evicts far ones and queues missing ones; view is in pixels
+    void update(const rectangle& view);
+
+private:
+    enum chunk_state : uint8_t
+    {
+        cs_absent,
+        cs_pending,
+        cs_resident,
+    };
+
+    struct decoded_chunk
+    {
+        uint32_t generation;
+        uint32_t index;
+        std::array<std::unique_ptr<tile[]>, 3> layers;
+    };
+
+    // copies of the attached map's layers; only the immutable compressed data is read from them
+    using layer_set = std::array<tile_layer, 3>;
+
+    void run();
+    void evict(uint32_t c);
+
+    tilemap* map = nullptr;
+    uint32_t radius = DEFAULT_RESIDENCY_RADIUS;
+    uint32_t chunks_w = 0, chunks_h = 0;
+    std::vector<chunk_state> states;
+    std::vector<uint32_t> resident;
+
+    std::mutex m;
+    std::condition_variable queue_cv;
+    std::shared_ptr<const layer_set> source;
+    std::deque<uint32_t> queue;
+    std::vector<decoded_chunk> finished;
+    uint32_t generation = 0;
+    bool quit = false;
+
+    std::thread worker;
+};
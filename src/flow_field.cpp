@@ -0,0 +1,243 @@
+#include "flow_field.hpp"
+
+#include <algorithm>
+
+#include "pathfinding.hpp"
+
+namespace
+{
+constexpr int DX[] = {1, 0, -1, 0}; // right, up, left, down
+constexpr int DY[] = {0, -1, 0, 1};
+} // namespace
+
+void flow_field::attach(const tilemap& m)
+{
+    map = &m;
+    for (field& f : fields)
+    {
+        f.complete = false;
+    }
+    has_target = false;
+    walked = MOVED_FAR;
+    building = false;
+    queue.clear();
+}
+
+void flow_field::set_radius(uint32_t tiles)
+{
+    radius = std::min<uint32_t>(tiles, UINT16_MAX);
+}
+
+void flow_field::set_target(uint32_t x, uint32_t y)
+{
+    if (!map || x >= map->width || y >= map->height)
+    {
+        has_target = false;
+        walked = MOVED_FAR;
+        return;
+    }
+
+    if (!has_target)
+    {
+        walked = MOVED_FAR;
+    }
+    else if (x != target_x || y != target_y)
+    {
+        // a single step the target could have taken keeps the last field repairable
+        int step = -1;
+        for (int d = 0; d < 4; ++d)
+        {
+            if (target_x + DX[d] == x && target_y + DY[d] == y)
+            {
+                step = d;
+            }
+        }
+
+        const bool stepped = step >= 0 && (tile_exits(*map, target_x, target_y) & (1 << step));
+        walked = stepped && walked != MOVED_FAR ? walked + 1 : MOVED_FAR;
+    }
+
+    target_x = x;
+    target_y = y;
+    has_target = true;
+}
+
+void flow_field::update(uint32_t budget)
+{
+    if (!building)
+    {
+        const bool current = front->complete && front->target_x == target_x && front->target_y == target_y;
+        if (!has_target || current)
+        {
+            return;
+        }
+        begin_build();
+    }
+
+    field& f = *back;
+    while (budget && queue_head < queue.size())
+    {
+        --budget;
+        ++f.searched;
+        const uint32_t c = queue[queue_head++];
+        const int32_t next_dist = f.dist[c] + 1;
+
+        const uint32_t x = c % f.width;
+        const uint32_t y = c / f.width;
+        for (int d = 0; d < 4; ++d)
+        {
+            const uint32_t nx = x + DX[d];
+            const uint32_t ny = y + DY[d];
+            if (nx >= f.width || ny >= f.height)
+            {
+                continue;
+            }
+
+            // only ever lowered, which is all a repair has to do
+            const uint32_t n = ny * f.width + nx;
+            if (f.dist[n] <= next_dist)
+            {
+                continue;
+            }
+
+            // the neighbour gets the direction that steps from it back onto c
+            const direction back_step = invert(static_cast<direction>(d));
+            if (!(exits_at(f, n) & (1 << back_step)))
+            {
+                continue;
+            }
+
+            f.dist[n] = next_dist;
+            f.dirs[n] = static_cast<uint8_t>(back_step);
+            queue.push_back(n);
+        }
+    }
+
+    if (queue_head == queue.size())
+    {
+        if (f.repaired)
+        {
+            point_old_target(f);
+        }
+        f.complete = true;
+        std::swap(front, back);
+        building = false;
+    }
+}
+
+bool flow_field::step_towards(uint32_t x, uint32_t y, direction& d) const
+{
+    const field& f = *front;
+    if (!f.complete || !f.contains(x, y))
+    {
+        return false;
+    }
+
+    const uint32_t i = f.index(x, y);
+    if (f.dist[i] == NO_DISTANCE || f.dirs[i] == NO_DIRECTION)
+    {
+        return false;
+    }
+
+    d = static_cast<direction>(f.dirs[i]);
+    return true;
+}
+
+uint32_t flow_field::distance(uint32_t x, uint32_t y) const
+{
+    const field& f = *front;
+    if (!f.complete || !f.contains(x, y))
+    {
+        return UNREACHED;
+    }
+
+    const uint32_t i = f.index(x, y);
+    return f.dist[i] == NO_DISTANCE ? UNREACHED : static_cast<uint32_t>(f.dist[i] + f.bias);
+}
+
+// Every distance in a complete field is exact, so after the target walks k steps each one is at
+// most k more (walk to the old target, then follow the target). Those upper bounds never differ by
+// more than one between neighbours, which is what lets a search from the new target that only
+// passes on improvements end up exact: a tile it doesn't reach already had its right distance,
+// and the direction it had still leads to a neighbour one step closer.
+void flow_field::begin_build()
+{
+    field& f = *back;
+    const field& old = *front;
+
+    const uint32_t dx = target_x > old.center_x ? target_x - old.center_x : old.center_x - target_x;
+    const uint32_t dy = target_y > old.center_y ? target_y - old.center_y : old.center_y - target_y;
+    f.repaired = old.complete && walked <= radius && dx <= SLACK && dy <= SLACK;
+
+    if (f.repaired)
+    {
+        f = old;
+        f.bias += static_cast<int32_t>(walked);
+        f.repaired = true;
+        f.old_target_x = old.target_x;
+        f.old_target_y = old.target_y;
+    }
+    else
+    {
+        const uint32_t reach = radius + SLACK;
+        f.center_x = target_x;
+        f.center_y = target_y;
+        f.left = target_x > reach ? target_x - reach : 0;
+        f.top = target_y > reach ? target_y - reach : 0;
+        f.width = std::min(target_x + reach + 1, map->width) - f.left;
+        f.height = std::min(target_y + reach + 1, map->height) - f.top;
+        f.bias = 0;
+
+        const size_t area = static_cast<size_t>(f.width) * f.height;
+        f.dist.assign(area, NO_DISTANCE);
+        f.dirs.assign(area, NO_DIRECTION);
+        f.exits.assign(area, EXITS_UNKNOWN);
+    }
+
+    f.complete = false;
+    f.searched = 0;
+    f.target_x = target_x;
+    f.target_y = target_y;
+    walked = 0;
+
+    const uint32_t t = f.index(target_x, target_y);
+    f.dist[t] = -f.bias;
+    f.dirs[t] = NO_DIRECTION;
+
+    queue.clear();
+    queue.push_back(t);
+    queue_head = 0;
+    building = true;
+}
+
+// the old target had no direction, and unless the search got to it, it still doesn't
+void flow_field::point_old_target(field& f)
+{
+    const uint32_t o = f.index(f.old_target_x, f.old_target_y);
+    if (f.dirs[o] != NO_DIRECTION || (f.old_target_x == f.target_x && f.old_target_y == f.target_y))
+    {
+        return;
+    }
+
+    const uint32_t x = o % f.width;
+    const uint32_t y = o / f.width;
+    for (int d = 0; d < 4; ++d)
+    {
+        const uint32_t nx = x + DX[d];
+        const uint32_t ny = y + DY[d];
+        if (nx < f.width && ny < f.height && (exits_at(f, o) & (1 << d)) && f.dist[ny * f.width + nx] == f.dist[o] - 1)
+        {
+            f.dirs[o] = static_cast<uint8_t>(d);
+            return;
+        }
+    }
+}
+
+uint8_t flow_field::exits_at(field& f, uint32_t i)
+{
+    if (f.exits[i] == EXITS_UNKNOWN)
+    {
+        f.exits[i] = tile_exits(*map, f.left + i % f.width, f.top + i / f.width);
+    }
+    return f.exits[i];
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "direction.hpp"
+#include "tilemap.hpp"
+
+// A direction on every tile near a target that leads along a shortest path to it, so any number
+// of entities can head for the same tile at the cost of one lookup each. Only a window reaching
+// radius + SLACK tiles out from where the target was at the last full rebuild is covered, and
+// nothing is allocated until there's a first field to build.
+//
+// Fields are built breadth first over the map's collision rules, spread over several update()
+// calls and into a back buffer; followers keep reading the last complete field until the new one
+// is swapped in. When the target has only walked a few steps since the last field, the new one is
+// repaired from it rather than rebuilt: no distance can have grown by more than the steps walked,
+// so that's added to all of them at once, and only the tiles that got closer are searched again.
+class flow_field
+{
+public:
+    static constexpr uint32_t DEFAULT_RADIUS = 48;
+    // how far the target can wander from the middle of the window before it's rebuilt around it
+    static constexpr uint32_t SLACK = 16;
+    static constexpr uint32_t DEFAULT_BUDGET = 4096;
+    static constexpr uint32_t UNREACHED = UINT32_MAX;
+
+    // drops both fields; call again whenever the map changes
+    void attach(const tilemap& map);
+
+    // in tiles; takes effect at the next full rebuild
+    void set_radius(uint32_t tiles);
+
+    // picked up by the next rebuild; call it every time the target moves, even while nothing
+    // follows the field, since repairs rely on knowing the steps it took
+    void set_target(uint32_t x, uint32_t y);
+
+    // continues the rebuild by up to budget tiles, starting one if the target moved
+    void update(uint32_t budget = DEFAULT_BUDGET);
+
+    // the first step from x, y towards the target; false on the target or out of reach
+    bool step_towards(uint32_t x, uint32_t y, direction& d) const;
+
+    // in steps, or UNREACHED
+    uint32_t distance(uint32_t x, uint32_t y) const;
+
+    // tiles the last completed field searched, and whether it was repaired from the one before
+    uint32_t last_build_tiles() const
+    {
+        return front->searched;
+    }
+
+    bool last_build_repaired() const
+    {
+        return front->repaired;
+    }
+
+private:
+    static constexpr int32_t NO_DISTANCE = INT32_MAX;
+    static constexpr uint8_t NO_DIRECTION = UINT8_MAX;
+    // tile_exits for a tile that hasn't been looked at yet
+    static constexpr uint8_t EXITS_UNKNOWN = 0x40;
+    // the target went further than a repair can follow since the newest field
+    static constexpr uint32_t MOVED_FAR = UINT32_MAX;
+
+    struct field
+    {
+        bool complete = false;
+        bool repaired = false;
+        uint32_t searched = 0;
+        uint32_t target_x = 0, target_y = 0;
+        // what a repair started from
+        uint32_t old_target_x = 0, old_target_y = 0;
+        // the target at the last full rebuild, which the window is placed around
+        uint32_t center_x = 0, center_y = 0;
+        // in map tiles, clipped to the map
+        uint32_t left = 0, top = 0, width = 0, height = 0;
+        // distances are dist + bias, so a repair can grow all of them at once
+        int32_t bias = 0;
+        std::vector<int32_t> dist;
+        std::vector<uint8_t> dirs;
+        // tile_exits, filled in as the search gets to them
+        std::vector<uint8_t> exits;
+
+        bool contains(uint32_t x, uint32_t y) const
+        {
+            return x - left < width && y - top < height;
+        }
+
+        uint32_t index(uint32_t x, uint32_t y) const
+        {
+            return (y - top) * width + (x - left);
+        }
+    };
+
+    void begin_build();
+    void point_old_target(field& f);
+    uint8_t exits_at(field& f, uint32_t i);
+
+    const tilemap* map = nullptr;
+    uint32_t radius = DEFAULT_RADIUS;
+
+    uint32_t target_x = 0, target_y = 0;
+    bool has_target = false;
+    // steps the target has taken since the newest field's target, or MOVED_FAR
+    uint32_t walked = MOVED_FAR;
+
+    field fields[2];
+    field* front = &fields[0];
+    field* back = &fields[1];
+
+    bool building = false;
+    std::vector<uint32_t> queue;
+    size_t queue_head = 0;
+};
@@ -4,8 +4,10 @@
 #include <vector>
 
 #include "camera.hpp"
+#include "foam_sites.hpp"
 #include "quad_renderer.hpp"
 #include "random.hpp"
+#include "random_vec.hpp"
 #include "rectangle.hpp"
 
 struct foam_particle
@@ -50,13 +52,54 @@ struct foam_emitter
 
     void emit(glm::vec2 world_pos, glm::vec2 vel, float scale_max = 3.f)
     {
+        rng_stream& rng = get_rng(rng_foam);
         foam_particle& p = particles.emplace_back();
         p.world_pos = world_pos;
-        p.initial_scale = random::rand_real(1, scale_max);
+        p.initial_scale = rng.rand_real(1, scale_max);
         p.scale = p.initial_scale;
         p.vel = vel;
     }
 
+    // Emits from the sites in cells overlapping view, each shoreline site at rate emissions per
+    // tick on average and each waterfall site at three times that. Instead of rolling for every
+    // site, the number of emissions in a cell is drawn from a Poisson distribution and that many
+    // sites are picked at random, so the cost follows the number of particles emitted. Sampling
+    // happens at the waterfall rate and shoreline picks are thinned back down.
+    void emit_near(const foam_sites& fs, const rectangle& view, float rate)
+    {
+        constexpr int CELL_PIXELS = foam_sites::CELL_TILES * 16;
+        int min_cx = std::max(view.left() / CELL_PIXELS, 0);
+        int min_cy = std::max(view.top() / CELL_PIXELS, 0);
+        int max_cx = std::min(view.right() / CELL_PIXELS, static_cast<int>(fs.cells_w) - 1);
+        int max_cy = std::min(view.bottom() / CELL_PIXELS, static_cast<int>(fs.cells_h) - 1);
+        rng_stream& rng = get_rng(rng_foam);
+
+        for (int cy = min_cy; cy <= max_cy; ++cy)
+        {
+            for (int cx = min_cx; cx <= max_cx; ++cx)
+            {
+                uint32_t cell = cy * fs.cells_w + cx;
+                uint32_t first = fs.cell_start[cell];
+                uint32_t count = fs.cell_start[cell + 1] - first;
+                if (count == 0)
+                {
+                    continue;
+                }
+
+                int n = rng.rand_poisson(count * 3 * rate);
+                for (int i = 0; i < n; ++i)
+                {
+                    const foam_site& s = fs.sites[first + rng.rand_int(0, count - 1)];
+                    if (s.edge != fe_waterfall && !rng.chance(1.0f / 3.0f))
+                    {
+                        continue;
+                    }
+                    emit_at(s);
+                }
+            }
+        }
+    }
+
     void update()
     {
         for (size_t i = 0; i < particles.size(); ++i)
@@ -74,4 +117,30 @@ struct foam_emitter
 
         particles.erase(first_dead, particles.end());
     }
-};
\ No newline at end of file
+
+private:
+    void emit_at(const foam_site& s)
+    {
+        float x = s.tile_x * 16.0f;
+        float y = s.tile_y * 16.0f;
+        rng_stream& rng = get_rng(rng_foam);
+        switch (s.edge)
+        {
+        case fe_left:
+            emit({x, y + rng.rand_int(0, 16)}, rand_vec2(rng, -0.8f, 0.0f, -0.5f, 0.0f));
+            break;
+        case fe_right:
+            emit({16 + x, y + rng.rand_int(0, 16)}, rand_vec2(rng, 0.0f, 0.8f, -0.5f, 0.0f));
+            break;
+        case fe_top:
+            emit({x + rng.rand_int(0, 16), y}, rand_vec2(rng, -0.2f, 0.2f, -0.8f, 0.0f));
+            break;
+        case fe_waterfall:
+            emit({x + rng.rand_int(0, 16), y}, rand_vec2(rng, -0.2f, 0.2f, -0.8f, 0.0f), 6.f);
+            break;
+        case fe_bottom:
+            emit({x + rng.rand_int(0, 16), 16 + y}, rand_vec2(rng, -0.2f, 0.2f, 0.0f, 0.8f));
+            break;
+        }
+    }
+};
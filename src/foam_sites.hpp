@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "tilemap.hpp"
+
+enum foam_edge : uint8_t
+{
+    fe_left,
+    fe_right,
+    fe_top,
+    fe_bottom,
+    // water directly below a waterfall tile; emits bigger foam at a higher rate
+    fe_waterfall,
+};
+
+// a water tile edge that emits foam
+struct foam_site
+{
+    uint16_t tile_x, tile_y;
+    foam_edge edge;
+};
+
+// Shoreline and waterfall emitter sites, found once when the map is loaded. Sites are bucketed
+// into square cells of tiles so the sites near the camera can be found without touching the
+// rest of the map.
+struct foam_sites
+{
+    static constexpr uint32_t CELL_TILES = 8;
+
+    uint32_t cells_w = 0, cells_h = 0;
+
+    // grouped by cell, row-major
+    std::vector<foam_site> sites;
+
+    // sites of cell i are [cell_start[i], cell_start[i + 1])
+    std::vector<uint32_t> cell_start;
+
+    size_t memory_usage() const
+    {
+        return sites.capacity() * sizeof(foam_site) + cell_start.capacity() * sizeof(uint32_t);
+    }
+};
+
+inline foam_sites find_foam_sites(const tilemap& map)
+{
+    foam_sites fs;
+    fs.cells_w = (map.width + foam_sites::CELL_TILES - 1) / foam_sites::CELL_TILES;
+    fs.cells_h = (map.height + foam_sites::CELL_TILES - 1) / foam_sites::CELL_TILES;
+
+    // three decoded rows of the base layer: above, current, below
+    std::vector<tile> rows[3];
+    for (std::vector<tile>& row : rows)
+    {
+        row.resize(map.width);
+    }
+
+    auto is_water = [&](const std::vector<tile>& row, uint32_t x) {
+        return !row[x].invalid() && row[x].is_water();
+    };
+    auto is_shore = [&](const std::vector<tile>& row, uint32_t x) {
+        return !row[x].invalid() && !row[x].is_water();
+    };
+
+    if (map.height)
+    {
+        map.base.decode_row(0, 0, rows[2]);
+    }
+
+    for (uint32_t y = 0; y < map.height; ++y)
+    {
+        std::swap(rows[0], rows[1]);
+        std::swap(rows[1], rows[2]);
+        if (y + 1 < map.height)
+        {
+            map.base.decode_row(y + 1, 0, rows[2]);
+        }
+
+        const std::vector<tile>& above = rows[0];
+        const std::vector<tile>& row = rows[1];
+        const std::vector<tile>& below = rows[2];
+
+        for (uint32_t x = 0; x < map.width; ++x)
+        {
+            if (!is_water(row, x))
+            {
+                continue;
+            }
+
+            uint16_t sx = static_cast<uint16_t>(x);
+            uint16_t sy = static_cast<uint16_t>(y);
+            if (x > 0 && is_shore(row, x - 1))
+                fs.sites.push_back({sx, sy, fe_left});
+            if (x + 1 < map.width && is_shore(row, x + 1))
+                fs.sites.push_back({sx, sy, fe_right});
+            if (y > 0 && is_shore(above, x))
+                fs.sites.push_back({sx, sy, fe_top});
+            if (y > 0 && !above[x].invalid() && above[x].is_waterfall())
+                fs.sites.push_back({sx, sy, fe_waterfall});
+            if (y + 1 < map.height && is_shore(below, x))
+                fs.sites.push_back({sx, sy, fe_bottom});
+        }
+    }
+
+    auto cell_of = [&](const foam_site& s) {
+        return (s.tile_y / foam_sites::CELL_TILES) * fs.cells_w + s.tile_x / foam_sites::CELL_TILES;
+    };
+
+    std::stable_sort(fs.sites.begin(), fs.sites.end(), [&](const foam_site& a, const foam_site& b) {
+        return cell_of(a) < cell_of(b);
+    });
+
+    fs.cell_start.assign(fs.cells_w * fs.cells_h + 1, 0);
+    for (const foam_site& s : fs.sites)
+    {
+        ++fs.cell_start[cell_of(s) + 1];
+    }
+    for (size_t i = 1; i < fs.cell_start.size(); ++i)
+    {
+        fs.cell_start[i] += fs.cell_start[i - 1];
+    }
+
+    return fs;
+}
@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <print>
 
+#include "animation_data.hpp"
+#include "battle/battle_character_info.hpp"
 #include "dialoguebox.hpp"
 #include "global_services.hpp"
 #include "mathutil.hpp"
@@ -55,6 +57,12 @@ game::game()
 
 game::~game()
 {
+    const audio_stats a = audio.stats();
+    if (a.underruns || a.dropped_voices || a.dropped_commands)
+    {
+        std::println("audio: {} underruns in {} callbacks (slowest {}us), {} voices and {} commands dropped", a.underruns, a.callbacks, a.max_callback_us, a.dropped_voices, a.dropped_commands);
+    }
+
     texman.clear();
 
     if (context)
@@ -75,6 +83,7 @@ game::~game()
 void game::init()
 {
     audio.init();
+    register_battle_sounds(audio);
     int w_width;
     int w_height;
     SDL_GetWindowSize(window, &w_width, &w_height);
@@ -95,7 +104,7 @@ void game::init()
 
     g_audio = &audio;
 
-    play = std::make_unique<st_play>(this, &sstate);
+    play = std::make_unique<st_play>(this, &sstate, map_cache_budget);
     mainmenu = std::make_unique<st_mainmenu>(this, &sstate);
     battle = std::make_unique<st_battle>(this, &sstate);
     gameover = std::make_unique<st_gameover>(this, &sstate);
@@ -111,7 +120,15 @@ void game::init()
     gamewin->init();
     options->init();
 
-    transition(transition_to::mainmenu);
+    if (battle_stress)
+    {
+        battle->start_stress_test();
+        transition(transition_to::battle);
+    }
+    else
+    {
+        transition(transition_to::mainmenu);
+    }
     // transition(transition_to::gamewin);
 
     t_mask = texman.get("assets/mask.png");
@@ -197,6 +214,16 @@ void game::init()
     glCullFace(GL_BACK);
 }
 
+void game::start_in_battle_stress_test()
+{
+    battle_stress = true;
+}
+
+void game::set_map_cache_budget(size_t bytes)
+{
+    map_cache_budget = bytes;
+}
+
 void game::run()
 {
     init();
@@ -356,6 +383,7 @@ void game::update()
     int window_w, window_h;
     SDL_GetWindowSize(window, &window_w, &window_h);
 
+    update_animation_clocks(frame_counter);
     current_st->update();
 
     ++frame_counter;
@@ -7,9 +7,11 @@
 #include "audio.hpp"
 #include "bmfont.hpp"
 #include "camera.hpp"
+#include "chunk_streamer.hpp"
 #include "foam_emitter.hpp"
 #include "gamestate.hpp"
 #include "imm_renderer.hpp"
+#include "map_loader.hpp"
 #include "quad_renderer.hpp"
 #include "screen_renderer.hpp"
 #include "shader.hpp"
@@ -25,6 +27,7 @@
 #include "timer.hpp"
 #include "water_renderer.hpp"
 #include "world.hpp"
+#include "world_cache.hpp"
 
 enum class transition_to
 {
@@ -48,6 +51,12 @@ public:
 
     void run();
 
+    // go straight into st_battle's stress test instead of the main menu
+    void start_in_battle_stress_test();
+
+    // bytes of visited maps kept loaded for revisits; takes effect at init
+    void set_map_cache_budget(size_t bytes);
+
     void transition(transition_to t);
     void transition(gamestate* t);
 
@@ -83,6 +92,8 @@ private:
     SDL_GLContext context = nullptr;
 
     bool running = false;
+    bool battle_stress = false;
+    size_t map_cache_budget = world_cache::DEFAULT_BUDGET;
 
     camera prev_cam;
     camera cam;
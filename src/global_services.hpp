@@ -3,3 +3,20 @@
 #include "audio.hpp"
 
 extern audio_system* g_audio;
+
+// sounds are skipped when there's no audio system, e.g. in tools and benchmarks
+inline void g_play_sound(const char* filename)
+{
+    if (g_audio)
+    {
+        g_audio->play_sound(filename);
+    }
+}
+
+inline void g_play_sound(sound_id id)
+{
+    if (g_audio && id != NO_SOUND)
+    {
+        g_audio->play_sound(id);
+    }
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct pool_handle
+{
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    uint32_t index = INVALID_INDEX;
+    uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return index != INVALID_INDEX;
+    }
+
+    bool operator==(const pool_handle&) const = default;
+};
+
+// Fixed-capacity storage with handles that notice when what they pointed at is gone. Items are
+// packed at the front of one array, so iterating is a plain loop and removing swaps the last item
+// into the hole. Handles go through a slot table and carry their slot's generation, which is
+// bumped on removal, so a stale handle resolves to nullptr rather than to whatever moved in.
+// Everything is reserved up front: adding and removing never allocate or invalidate references
+// to other items (except the one swapped into a hole). Copying a pool into another never allocates
+// either, and only copies the slots that have ever been handed out.
+template <typename T, uint32_t Capacity>
+class handle_pool
+{
+    static constexpr uint32_t NO_ITEM = UINT32_MAX;
+
+    struct slot
+    {
+        uint32_t item = NO_ITEM;
+        uint32_t generation = 0;
+        uint32_t next_free = 0;
+    };
+
+public:
+    static constexpr uint32_t CAPACITY = Capacity;
+
+    // just the live items and the slots handed out so far, for keeping copies of a pool without
+    // paying for its whole capacity each time
+    struct saved_state
+    {
+        std::vector<T> items;
+        std::vector<uint32_t> item_slots;
+        std::vector<slot> slots;
+        uint32_t free_slot = 0;
+    };
+
+    handle_pool()
+    {
+        items.reserve(Capacity);
+        item_slots.reserve(Capacity);
+        slots.resize(Capacity);
+        for (uint32_t i = 0; i < Capacity; ++i)
+        {
+            slots[i].next_free = i + 1;
+        }
+    }
+
+    handle_pool(const handle_pool& other)
+        : handle_pool()
+    {
+        *this = other;
+    }
+
+    handle_pool& operator=(const handle_pool& other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        items = other.items;
+        item_slots = other.item_slots;
+
+        // slots past the high water mark are as the constructor left them
+        std::copy_n(other.slots.begin(), other.slots_used, slots.begin());
+        for (uint32_t i = other.slots_used; i < slots_used; ++i)
+        {
+            slots[i] = {NO_ITEM, 0, i + 1};
+        }
+        slots_used = other.slots_used;
+        free_slot = other.free_slot;
+        return *this;
+    }
+
+    // only allocates when the pool holds more than out has held before
+    void save(saved_state& out) const
+    {
+        out.items.assign(items.begin(), items.end());
+        out.item_slots.assign(item_slots.begin(), item_slots.end());
+        out.slots.assign(slots.begin(), slots.begin() + slots_used);
+        out.free_slot = free_slot;
+    }
+
+    // never allocates; handles taken after the save mustn't be used once it's restored
+    void restore(const saved_state& in)
+    {
+        items.assign(in.items.begin(), in.items.end());
+        item_slots.assign(in.item_slots.begin(), in.item_slots.end());
+
+        const uint32_t in_used = static_cast<uint32_t>(in.slots.size());
+        std::copy(in.slots.begin(), in.slots.end(), slots.begin());
+        for (uint32_t i = in_used; i < slots_used; ++i)
+        {
+            slots[i] = {NO_ITEM, 0, i + 1};
+        }
+        slots_used = in_used;
+        free_slot = in.free_slot;
+    }
+
+    // when full, whichever item happens to be first in the packed array is dropped to make room.
+    // removals shuffle that order, so it's an arbitrary item (though the same one on every run),
+    // not the oldest.
+    template <typename... Args>
+    T& add(Args&&... args)
+    {
+        if (items.size() == Capacity)
+        {
+            remove_at(0);
+        }
+
+        const uint32_t slot = free_slot;
+        free_slot = slots[slot].next_free;
+        slots_used = std::max(slots_used, slot + 1);
+        slots[slot].item = static_cast<uint32_t>(items.size());
+
+        item_slots.push_back(slot);
+        return items.emplace_back(std::forward<Args>(args)...);
+    }
+
+    T* get(pool_handle h)
+    {
+        if (h.index >= Capacity || slots[h.index].generation != h.generation || slots[h.index].item == NO_ITEM)
+        {
+            return nullptr;
+        }
+        return &items[slots[h.index].item];
+    }
+
+    const T* get(pool_handle h) const
+    {
+        return const_cast<handle_pool*>(this)->get(h);
+    }
+
+    pool_handle handle_at(size_t i) const
+    {
+        assert(i < items.size());
+        const uint32_t slot = item_slots[i];
+        return {slot, slots[slot].generation};
+    }
+
+    pool_handle handle_of(const T& item) const
+    {
+        return handle_at(static_cast<size_t>(&item - items.data()));
+    }
+
+    void remove_at(size_t i)
+    {
+        assert(i < items.size());
+        const uint32_t slot = item_slots[i];
+        slots[slot].item = NO_ITEM;
+        ++slots[slot].generation;
+        slots[slot].next_free = free_slot;
+        free_slot = slot;
+
+        if (i + 1 != items.size())
+        {
+            items[i] = std::move(items.back());
+            item_slots[i] = item_slots.back();
+            slots[item_slots[i]].item = static_cast<uint32_t>(i);
+        }
+        items.pop_back();
+        item_slots.pop_back();
+    }
+
+    bool remove(pool_handle h)
+    {
+        T* item = get(h);
+        if (!item)
+        {
+            return false;
+        }
+        remove_at(static_cast<size_t>(item - items.data()));
+        return true;
+    }
+
+    template <typename Pred>
+    void remove_if(Pred&& pred)
+    {
+        for (size_t i = 0; i < items.size();)
+        {
+            if (pred(items[i]))
+            {
+                // look at whatever got swapped in
+                remove_at(i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    void clear()
+    {
+        while (items.size())
+        {
+            remove_at(items.size() - 1);
+        }
+    }
+
+    size_t size() const
+    {
+        return items.size();
+    }
+
+    bool empty() const
+    {
+        return items.empty();
+    }
+
+    T& operator[](size_t i)
+    {
+        return items[i];
+    }
+
+    const T& operator[](size_t i) const
+    {
+        return items[i];
+    }
+
+    auto begin()
+    {
+        return items.begin();
+    }
+
+    auto end()
+    {
+        return items.end();
+    }
+
+    auto begin() const
+    {
+        return items.begin();
+    }
+
+    auto end() const
+    {
+        return items.end();
+    }
+
+private:
+    std::vector<T> items;
+    std::vector<uint32_t> item_slots;
+    std::vector<slot> slots;
+    // one past the highest slot ever handed out
+    uint32_t slots_used = 0;
+    uint32_t free_slot = 0;
+};
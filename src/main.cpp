@@ -1,13 +1,25 @@
 #include <SDL.h>
+#include <cstdlib>
+#include <string_view>
 
 #include "game.hpp"
 
 int main(int argc, char* argv[])
 {
-    (void)argc;
-    (void)argv;
-
     game g;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string_view{argv[i]} == "--battle-stress")
+        {
+            g.start_in_battle_stress_test();
+        }
+        else if (std::string_view{argv[i]} == "--map-cache-mb" && i + 1 < argc)
+        {
+            g.set_map_cache_budget(std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024);
+        }
+    }
+
     g.run();
 
     return 0;
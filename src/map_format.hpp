@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+
+// On-disk layout of version 3 map files as written by scripts/tiled2map.py. Everything is little
+// endian and every section starts on a 4 byte boundary so the file can be memory-mapped and read
+// in place.
+//
+//   map_file_header
+//   string table:    map_string_entry[string_count], followed by the string bytes
+//   tile layers:     map_layer_record[3] for base, detail, fringe, each pointing at its data
+//   entities:        map_entity_record[entity_count]
+//   properties:      map_properties_record
+//
+// Layer data is either raw32 (width * height tile IDs, already corrected) or rle16:
+//
+//   uint32_t row_starts[height + 1]   index of each row's first run
+//   tile_run runs[row_starts[height]] 16 bit tile ID and inclusive last column of each run
+//
+// or chunked16, for maps too big to keep decoded in full:
+//
+//   tile_chunk_entry index[chunks_w * chunks_h]  row-major, CHUNK_TILES square chunks
+//   chunk data                                   see tile_chunk_entry; identical chunks may
+//                                                share data
+//
+// Version 2 files, which store the three layers as consecutive raw32 data at layers_offset, and
+// version 1 files (headerless, starting with width/height) are still accepted by load_world.
+
+// "UFM2"
+constexpr uint32_t MAP_FILE_MAGIC = 0x324d4655;
+constexpr uint32_t MAP_FILE_VERSION = 3;
+constexpr uint32_t MAP_FILE_VERSION_RAW_LAYERS = 2;
+
+// string index 0 is always the empty string
+constexpr uint32_t MAP_EMPTY_STRING = 0;
+constexpr uint32_t MAP_NO_VALUE = UINT32_MAX;
+
+struct map_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t string_table_offset;
+    uint32_t string_count;
+    uint32_t layers_offset;
+    uint32_t entities_offset;
+    uint32_t entity_count;
+    uint32_t properties_offset;
+};
+
+struct map_string_entry
+{
+    // relative to the first byte after the last entry
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct map_layer_record
+{
+    uint32_t encoding; // tile_encoding
+    uint32_t offset;   // from the start of the file
+    uint32_t size;     // in bytes
+};
+
+struct map_entity_record
+{
+    uint32_t name;        // string index
+    uint32_t type;        // entity_type
+    uint32_t world_x;
+    uint32_t world_y;
+    uint32_t interact_id; // MAP_NO_VALUE if absent
+    uint32_t sprite_id;   // MAP_NO_VALUE if absent
+    uint32_t exit_map;    // string index
+    uint32_t exit_name;   // string index
+    float light_radius;
+    float light_flicker_radius;
+    uint32_t active;
+};
+
+struct map_properties_record
+{
+    uint32_t map_name;          // string index
+    uint32_t map_subtitle;      // string index
+    uint32_t music_name;        // string index
+    uint32_t battle_field_name; // string index
+    float water_direction_x;
+    float water_direction_y;
+    float water_drift_x;
+    float water_drift_y;
+    float water_speed;
+    uint32_t dark;
+    uint32_t encounter_set_id; // MAP_NO_VALUE if absent
+};
+
+static_assert(sizeof(map_file_header) == 40);
+static_assert(sizeof(map_string_entry) == 8);
+static_assert(sizeof(map_layer_record) == 12);
+static_assert(sizeof(map_entity_record) == 44);
+static_assert(sizeof(map_properties_record) == 44);
@@ -0,0 +1,179 @@
+#include "map_loader.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <print>
+#include <utility>
+
+#include "audio.hpp"
+
+map_loader::map_loader(audio_system* a)
+    : audio{a}
+{
+    worker = std::thread([this]() { run(); });
+}
+
+map_loader::~map_loader()
+{
+    {
+        std::scoped_lock lk(slots_m);
+        quit = true;
+    }
+    queue_cv.notify_one();
+    worker.join();
+}
+
+void map_loader::prefetch(const std::string& map_name)
+{
+    {
+        std::scoped_lock lk(slots_m);
+        if (slots.count(map_name))
+        {
+            return;
+        }
+        slots.emplace(map_name, load_slot{});
+        queue.push_back(map_name);
+    }
+    queue_cv.notify_one();
+}
+
+bool map_loader::is_ready(const std::string& map_name)
+{
+    std::scoped_lock lk(slots_m);
+    auto it = slots.find(map_name);
+    return it != slots.end() && it->second.done;
+}
+
+world map_loader::take(const std::string& map_name)
+{
+    load_slot slot;
+    {
+        std::scoped_lock lk(slots_m);
+        auto it = slots.find(map_name);
+        assert(it != slots.end() && it->second.done && "map was not prefetched");
+        slot = std::move(it->second);
+        slots.erase(it);
+    }
+
+    if (slot.error)
+    {
+        std::rethrow_exception(slot.error);
+    }
+
+    return std::move(slot.wor);
+}
+
+void map_loader::discard_except(std::span<const std::string> keep)
+{
+    std::scoped_lock lk(slots_m);
+    std::erase_if(slots, [&](const auto& kv) {
+        return kv.second.done && std::find(keep.begin(), keep.end(), kv.first) == keep.end();
+    });
+}
+
+void map_loader::build_routes(const std::string& first_map)
+{
+    {
+        std::scoped_lock lk(slots_m);
+        route_builder = std::make_unique<portal_graph_builder>(first_map);
+        routes.reset();
+    }
+    queue_cv.notify_one();
+}
+
+std::optional<portal_graph> map_loader::take_routes()
+{
+    std::scoped_lock lk(slots_m);
+    return std::exchange(routes, std::nullopt);
+}
+
+void map_loader::step_routes()
+{
+    std::unique_ptr<portal_graph_builder> builder;
+    {
+        std::scoped_lock lk(slots_m);
+        builder = std::move(route_builder);
+    }
+
+    // routes are a nice to have, so a bad map behind some portal only costs the routes
+    std::optional<portal_graph> built;
+    try
+    {
+        if (builder->step())
+        {
+            built = builder->take();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::println("could not build routes: {}", e.what());
+        return;
+    }
+
+    // unless build_routes started over in the meantime
+    std::scoped_lock lk(slots_m);
+    if (route_builder)
+    {
+        return;
+    }
+
+    if (built)
+    {
+        routes = std::move(built);
+    }
+    else
+    {
+        route_builder = std::move(builder);
+    }
+}
+
+void map_loader::run()
+{
+    while (true)
+    {
+        std::string map_name;
+        {
+            std::unique_lock<std::mutex> lk(slots_m);
+            queue_cv.wait(lk, [&]() { return quit || queue.size() || route_builder; });
+
+            if (quit)
+            {
+                return;
+            }
+
+            // loads come first, the graph only gets the time nobody's waiting on
+            if (queue.empty())
+            {
+                lk.unlock();
+                step_routes();
+                continue;
+            }
+
+            map_name = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        // the expensive part happens without holding the lock
+        load_slot result;
+        result.done = true;
+        try
+        {
+            result.wor = load_world(std::format("assets/maps/{}.bin", map_name));
+
+            // decode the music now so play_music hits the cache when the map intro starts
+            if (audio && result.wor.music_name.size())
+            {
+                audio->get_or_load(std::format("assets/music/{}.ogg", result.wor.music_name).c_str());
+            }
+        }
+        catch (...)
+        {
+            result.error = std::current_exception();
+        }
+
+        // only completed slots are ever removed, so ours is still there
+        std::scoped_lock lk(slots_m);
+        slots.at(map_name) = std::move(result);
+    }
+}
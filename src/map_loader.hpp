@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "portal_graph.hpp"
+#include "world.hpp"
+
+class audio_system;
+
+// Loads maps on a worker thread so that map transitions never stall the main thread. Along with
+// the map itself the worker decodes the map's music into the audio cache. While no loads are
+// waiting it builds the portal graph, a map at a time.
+class map_loader
+{
+public:
+    explicit map_loader(audio_system* audio);
+    ~map_loader();
+
+    map_loader(const map_loader&) = delete;
+    map_loader& operator=(const map_loader&) = delete;
+
+    // queues a background load; does nothing if the map is already queued or loaded
+    void prefetch(const std::string& map_name);
+
+    // true once the map has been queued and its load has completed
+    bool is_ready(const std::string& map_name);
+
+    // removes a completed map; rethrows if loading it failed. is_ready must have returned true.
+    world take(const std::string& map_name);
+
+    // drops completed maps whose names aren't in keep; in-flight loads are left alone
+    void discard_except(std::span<const std::string> keep);
+
+    // starts building the routes between every map reachable from first_map, replacing any
+    // build still going
+    void build_routes(const std::string& first_map);
+
+    // the routes once build_routes has finished, and nothing before that. a build that fails,
+    // say on a missing map behind a portal, is logged and never produces any.
+    std::optional<portal_graph> take_routes();
+
+private:
+    struct load_slot
+    {
+        bool done = false;
+        world wor;
+        std::exception_ptr error;
+    };
+
+    void run();
+    void step_routes();
+
+    audio_system* audio;
+
+    std::mutex slots_m;
+    std::condition_variable queue_cv;
+    std::deque<std::string> queue;
+    std::unordered_map<std::string, load_slot> slots;
+    bool quit = false;
+
+    // only the worker steps the builder, and takes it out of here while it does
+    std::unique_ptr<portal_graph_builder> route_builder;
+    std::optional<portal_graph> routes;
+
+    std::thread worker;
+};
@@ -0,0 +1,110 @@
+#include "mapped_file.hpp"
+
+#include <string>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::shared_ptr<const mapped_file> mapped_file::open(std::string_view filename)
+{
+    auto mf = std::make_shared<mapped_file>();
+
+    const std::string filename_str{filename};
+    HANDLE file = CreateFileA(filename_str.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+    mf->file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        return nullptr;
+    }
+    mf->mapping_handle = mapping;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view)
+    {
+        return nullptr;
+    }
+
+    mf->base = static_cast<const std::byte*>(view);
+    mf->length = static_cast<size_t>(file_size.QuadPart);
+    return mf;
+}
+
+mapped_file::~mapped_file()
+{
+    if (base)
+    {
+        UnmapViewOfFile(base);
+    }
+    if (mapping_handle)
+    {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle)
+    {
+        CloseHandle(file_handle);
+    }
+}
+
+#else
+
+std::shared_ptr<const mapped_file> mapped_file::open(std::string_view filename)
+{
+    const std::string filename_str{filename};
+    int fd = ::open(filename_str.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (view == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    auto mf = std::make_shared<mapped_file>();
+    mf->base = static_cast<const std::byte*>(view);
+    mf->length = static_cast<size_t>(st.st_size);
+    return mf;
+}
+
+mapped_file::~mapped_file()
+{
+    if (base)
+    {
+        munmap(const_cast<std::byte*>(base), length);
+    }
+}
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+// read-only memory mapping of an entire file
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    ~mapped_file();
+
+    // non-copyable
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    // returns nullptr if the file could not be opened or mapped
+    static std::shared_ptr<const mapped_file> open(std::string_view filename);
+
+    const std::byte* data() const
+    {
+        return base;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const std::byte* base = nullptr;
+    size_t length = 0;
+
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
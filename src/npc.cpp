@@ -6,34 +6,37 @@
 #include "gamestate.hpp"
 #include "world.hpp"
 
-void hub_spawnroom_npc(npc_context& context)
+npc_task hub_spawnroom_npc(npc_context context)
 {
     context.say("Something isn't right...");
     context.say("The elder went into the East Tower\na while ago, but he hasn't come back yet.");
     context.say("I think someone should check on him.");
     // context.say("By the way, did you know that you can\nattack by pressing X and jump by pressing ALT?");
     // context.say("At least, I read that somewhere, but I\nhaven't figured out what it means yet.");
+    co_return;
 }
 
-void generic_door(npc_context& context)
+npc_task generic_door(npc_context context)
 {
     if (!context.self()->open)
     {
         context.play_sound("door");
     }
     context.self()->set_doorstate(true);
+    co_return;
 }
 
-void generic_metal_door(npc_context& context)
+npc_task generic_metal_door(npc_context context)
 {
     if (!context.self()->open)
     {
         context.play_sound("metal_door");
     }
     context.self()->set_doorstate(true);
+    co_return;
 }
 
-void east_tower_basement_door(npc_context& context)
+npc_task east_tower_basement_door(npc_context context)
 {
     if (context.get_flag("east_tower_basement_door") == 1)
     {
@@ -47,9 +50,10 @@ void east_tower_basement_door(npc_context& context)
     {
         context.say("This door won't open without a key.");
     }
+    co_return;
 }
 
-void east_tower_key_npc(npc_context& context)
+npc_task east_tower_key_npc(npc_context context)
 {
     if (context.get_flag("east_tower_basement_door"))
     {
@@ -60,40 +64,46 @@ void east_tower_key_npc(npc_context& context)
         context.say("You're trying to get into the East Tower?\nI have the key here. You may use it.");
         context.set_flag("east_tower_basement_door", 1);
     }
+    co_return;
 }
 
-void change_to_light(npc_context& context)
+npc_task change_to_light(npc_context context)
 {
-    if (context.self()->type != et_light)
+    if (context.self()->get_type() != et_light)
     {
-        context.self()->type = et_light;
+        context.self()->set_type(et_light);
         context.self()->set_sprite_id(10);
         context.play_sound("torch");
     }
+    co_return;
 }
 
-void dead_body(npc_context& context)
+npc_task dead_body(npc_context context)
 {
     context.say("The corpse is still warm.\nThis person was killed recently.");
+    co_return;
 }
 
-void placeholder(npc_context& context)
+npc_task placeholder(npc_context context)
 {
     context.say("You found a corndog.");
+    co_return;
 }
 
-void switch_test(npc_context& context)
+npc_task switch_test(npc_context context)
 {
     context.play_sound("switch");
     context.self()->set_switchstate(!context.self()->get_switchstate());
+    co_return;
 }
 
-void puzzle_door(npc_context& context)
+npc_task puzzle_door(npc_context context)
 {
     if (!context.self()->open)
     {
         context.say("This door is firmly shut. There's no way to open it manually.");
     }
+    co_return;
 }
 
 bool is_puzzle_door_solved(npc_context& context)
@@ -123,26 +133,29 @@ void puzzle_door_switch(npc_context& context, const char* name)
     }
 }
 
-void puzzle_door_switch1(npc_context& context)
+npc_task puzzle_door_switch1(npc_context context)
 {
     puzzle_door_switch(context, "puzzle_door_switch1");
+    co_return;
 }
 
-void puzzle_door_switch2(npc_context& context)
+npc_task puzzle_door_switch2(npc_context context)
 {
     puzzle_door_switch(context, "puzzle_door_switch2");
+    co_return;
 }
 
-void puzzle_door_switch3(npc_context& context)
+npc_task puzzle_door_switch3(npc_context context)
 {
     puzzle_door_switch(context, "puzzle_door_switch3");
+    co_return;
 }
 
-void fj_room_torch(npc_context& context)
+npc_task fj_room_torch(npc_context context)
 {
-    if (context.self()->type != et_light)
+    if (context.self()->get_type() != et_light)
     {
-        context.self()->type = et_light;
+        context.self()->set_type(et_light);
         context.self()->set_sprite_id(10);
         context.play_sound("torch");
         context.set_flag("fj_room_torch", context.get_flag("fj_room_torch") + 1);
@@ -153,9 +166,33 @@ void fj_room_torch(npc_context& context)
             chest->set_active(true);
         }
     }
+    co_return;
 }
 
-void fj_chest(npc_context& context)
+npc_task light_path(npc_context context)
+{
+    for (;;)
+    {
+        uint32_t current_torch = context.get_flag("light_path");
+        context.set_flag("light_path", current_torch + 1);
+
+        if (current_torch == 6)
+        {
+            context.set_encounter_state(true);
+            co_return;
+        }
+
+        std::string current_torch_name = std::format("maze_torch_{}", current_torch);
+        entity* torch = context.get_entity(current_torch_name.c_str());
+        assert(torch);
+        torch->set_type(et_light);
+        torch->set_sprite_id(10);
+        context.play_sound("torch");
+        co_await context.wait(3);
+    }
+}
+
+npc_task fj_chest(npc_context context)
 {
     // chests are actually one-time switches lol
     if (!context.self()->get_switchstate())
@@ -165,32 +202,13 @@ void fj_chest(npc_context& context)
         context.say("Press JUMP again when you're near the\napex of your jump to propel yourself forward.");
         context.self()->toggle_switchstate();
         context.play_sound("chest");
-        context.schedule(13, 5);
         context.set_encounter_state(false);
+        co_await context.wait(5);
+        co_await light_path(context);
     }
 }
 
-void light_path(npc_context& context)
-{
-    uint32_t current_torch = context.get_flag("light_path");
-    context.set_flag("light_path", current_torch + 1);
-
-    if (current_torch == 6)
-    {
-        context.set_encounter_state(true);
-        return;
-    }
-
-    std::string current_torch_name = std::format("maze_torch_{}", current_torch);
-    entity* torch = context.get_entity(current_torch_name.c_str());
-    assert(torch);
-    torch->type = et_light;
-    torch->set_sprite_id(10);
-    context.play_sound("torch");
-    context.schedule(13, 3);
-}
-
-void dungeon_elder(npc_context& context)
+npc_task dungeon_elder(npc_context context)
 {
     if (context.get_flag("elder_pendant") == 0)
     {
@@ -203,14 +221,16 @@ void dungeon_elder(npc_context& context)
     {
         context.say("The elder has passed on.");
     }
+    co_return;
 }
 
-void barely_breathing(npc_context& context)
+npc_task barely_breathing(npc_context context)
 {
     context.say("She's barely breathing.");
+    co_return;
 }
 
-void elder_door(npc_context& context)
+npc_task elder_door(npc_context context)
 {
     if (context.get_flag("elder_pendant") == 0)
     {
@@ -221,9 +241,10 @@ void elder_door(npc_context& context)
         context.self()->set_doorstate(true);
         context.play_sound("metal_door");
     }
+    co_return;
 }
 
-void coffee_man(npc_context& context)
+npc_task coffee_man(npc_context context)
 {
     if (context.get_flag("elder_pendant") == 0)
     {
@@ -233,9 +254,10 @@ void coffee_man(npc_context& context)
     {
         context.say("Coffee...");
     }
+    co_return;
 }
 
-void sanctum_hub_door(npc_context& context)
+npc_task sanctum_hub_door(npc_context context)
 {
     if (context.get_flag("elder_pendant") == 0)
     {
@@ -246,9 +268,10 @@ void sanctum_hub_door(npc_context& context)
         context.self()->set_doorstate(true);
         context.play_sound("metal_door");
     }
+    co_return;
 }
 
-void avenger_chest(npc_context& context)
+npc_task avenger_chest(npc_context context)
 {
     if (!context.self()->get_switchstate())
     {
@@ -258,15 +281,17 @@ void avenger_chest(npc_context& context)
         context.self()->toggle_switchstate();
         context.play_sound("chest");
     }
+    co_return;
 }
 
-void oracle_1(npc_context& context)
+npc_task oracle_1(npc_context context)
 {
     context.say("Welcome to the Sanctum of Thought, where memories\nof all origins converge.");
     context.say("I am aware that you've come here following a monster\ncalled Ragworm. You must navigate the amalgamation\nof thought to find what you seek.");
+    co_return;
 }
 
-void oracle_2(npc_context& context)
+npc_task oracle_2(npc_context context)
 {
     if (context.get_flag("oracle_2") == 0)
     {
@@ -278,22 +303,22 @@ void oracle_2(npc_context& context)
     {
         context.say("I have nothing more to give you.");
     }
+    co_return;
 }
 
-void ragworm(npc_context& context)
+npc_task ragworm(npc_context context)
 {
     context.say("AM I YOU? ARE YOU ME?");
     context.say("ARE WE ALL RAGWORM?");
-    context.say("HAHAHAHAHAHAHAHA!!");
-    // the final hack
-    // this initiates a scripted encounter
-    context.say("#ragworm");
+    co_await context.say("HAHAHAHAHAHAHAHA!!");
+    context.begin_final_battle();
 }
 
-void devs_reference(npc_context& context)
+npc_task devs_reference(npc_context context)
 {
     context.say("-points-");
     context.say("Ture che qutatu.");
+    co_return;
 }
 
 npc_interact_script get_npc_interact_script(uint32_t id)
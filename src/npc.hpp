@@ -3,19 +3,29 @@
 #include <cstdint>
 #include <string>
 
+#include "direction.hpp"
+#include "npc_task.hpp"
+
 struct session_state;
 struct entity;
 
-struct npc_context
+// what scripts can do to the game; st_play implements it
+class npc_host
 {
+public:
+    virtual ~npc_host() = default;
+
     // engine interaction
-    virtual void say(const std::string& message) = 0;
+    virtual task_wait say(uint32_t task, const std::string& message) = 0;
     virtual void play_sound(const char* name) = 0;
-    virtual void schedule(uint32_t id, double seconds_from_now) = 0;
+    virtual task_wait wait(uint32_t task, double seconds) = 0;
+    virtual task_wait walk(uint32_t task, entity* e, direction d) = 0;
+    virtual task_wait until_idle(uint32_t task) = 0;
+    virtual void begin_final_battle() = 0;
 
     // world interaction
-    virtual entity* self() const = 0;
     virtual entity* get_entity(const char* name) = 0;
+    virtual void set_chasing(entity* e, bool chase) = 0;
     virtual void set_encounter_state(bool enabled) = 0;
 
     // quest management
@@ -26,6 +36,84 @@ struct npc_context
     virtual session_state* session() = 0;
 };
 
-using npc_interact_script = void (*)(npc_context& context);
+// Handed to scripts by value so it lives in the coroutine frame for as long as the script is
+// suspended. Everything that returns a task_wait can be co_awaited, or ignored to not wait.
+struct npc_context
+{
+    npc_host* host;
+    entity* ent;
+    uint32_t task;
+
+    // queues a message; awaiting it resumes once the player has closed it
+    task_wait say(const std::string& message)
+    {
+        return host->say(task, message);
+    }
+
+    void play_sound(const char* name)
+    {
+        host->play_sound(name);
+    }
+
+    task_wait wait(double seconds)
+    {
+        return host->wait(task, seconds);
+    }
+
+    // starts a one tile step; awaiting it resumes when the step is done, with false if it couldn't be taken
+    task_wait walk(entity* e, direction d)
+    {
+        return host->walk(task, e, d);
+    }
+
+    // resumes once no message, fade or transition is in the way
+    task_wait until_idle()
+    {
+        return host->until_idle(task);
+    }
+
+    void begin_final_battle()
+    {
+        host->begin_final_battle();
+    }
+
+    entity* self() const
+    {
+        return ent;
+    }
+
+    entity* get_entity(const char* name)
+    {
+        return host->get_entity(name);
+    }
+
+    // e walks towards the player on its own until told to stop
+    void set_chasing(entity* e, bool chase)
+    {
+        host->set_chasing(e, chase);
+    }
+
+    void set_encounter_state(bool enabled)
+    {
+        host->set_encounter_state(enabled);
+    }
+
+    void set_flag(const char* name, int value)
+    {
+        host->set_flag(name, value);
+    }
+
+    int get_flag(const char* name)
+    {
+        return host->get_flag(name);
+    }
+
+    session_state* session()
+    {
+        return host->session();
+    }
+};
+
+using npc_interact_script = npc_task (*)(npc_context context);
 
 npc_interact_script get_npc_interact_script(uint32_t id);
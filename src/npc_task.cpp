@@ -0,0 +1,216 @@
+#include "npc_task.hpp"
+
+#include <cassert>
+#include <memory>
+#include <new>
+
+namespace
+{
+constexpr size_t MIN_FRAME_SIZE = 64;
+constexpr size_t SIZE_CLASS_COUNT = 7; // 64 bytes to 4K
+constexpr size_t FRAMES_PER_CHUNK = 32;
+
+struct free_frame
+{
+    free_frame* next;
+};
+
+struct frame_pool_state
+{
+    free_frame* free_lists[SIZE_CLASS_COUNT] = {};
+    std::vector<std::unique_ptr<std::byte[]>> chunks;
+};
+
+frame_pool_state& frame_pool()
+{
+    static frame_pool_state state;
+    return state;
+}
+
+// SIZE_CLASS_COUNT if too big for the pool
+size_t size_class(size_t size)
+{
+    size_t c = 0;
+    while (c < SIZE_CLASS_COUNT && (MIN_FRAME_SIZE << c) < size)
+    {
+        ++c;
+    }
+    return c;
+}
+} // namespace
+
+void* task_frame_pool::allocate(size_t size)
+{
+    const size_t c = size_class(size);
+    if (c == SIZE_CLASS_COUNT)
+    {
+        return ::operator new(size);
+    }
+
+    frame_pool_state& pool = frame_pool();
+    if (!pool.free_lists[c])
+    {
+        const size_t frame_size = MIN_FRAME_SIZE << c;
+        std::byte* chunk = pool.chunks.emplace_back(new std::byte[frame_size * FRAMES_PER_CHUNK]).get();
+        for (size_t i = 0; i < FRAMES_PER_CHUNK; ++i)
+        {
+            free_frame* f = new (chunk + i * frame_size) free_frame{pool.free_lists[c]};
+            pool.free_lists[c] = f;
+        }
+    }
+
+    free_frame* f = pool.free_lists[c];
+    pool.free_lists[c] = f->next;
+    return f;
+}
+
+void task_frame_pool::release(void* p, size_t size)
+{
+    const size_t c = size_class(size);
+    if (c == SIZE_CLASS_COUNT)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    frame_pool_state& pool = frame_pool();
+    pool.free_lists[c] = new (p) free_frame{pool.free_lists[c]};
+}
+
+uint32_t task_scheduler::reserve()
+{
+    if (free_tasks.size())
+    {
+        return free_tasks.back();
+    }
+    return static_cast<uint32_t>(tasks.size());
+}
+
+void task_scheduler::start(uint32_t task, npc_task t)
+{
+    assert(task == reserve());
+    if (free_tasks.size())
+    {
+        free_tasks.pop_back();
+    }
+    else
+    {
+        tasks.emplace_back();
+    }
+
+    tasks[task] = std::move(t);
+
+    // the script may cancel everything before it first suspends, itself included
+    const bool nested = in_update;
+    in_update = true;
+    resume({tasks[task].h, task});
+    in_update = nested;
+
+    if (!in_update && cancel_requested)
+    {
+        destroy_all();
+    }
+}
+
+void task_scheduler::signal(uint32_t event)
+{
+    assert(event < MAX_EVENTS);
+    event_state& e = events[event];
+    ++e.count;
+    while (e.waiters.size() && e.waiters.front().target <= e.count)
+    {
+        ready.push_back(e.waiters.front().p);
+        e.waiters.pop_front();
+    }
+}
+
+void task_scheduler::update(uint32_t frame)
+{
+    current_frame = frame;
+    timers.advance(frame, [this](parked p) { ready.push_back(p); });
+
+    // resumed scripts can ready others, which then run this update too
+    in_update = true;
+    while (ready.size() && !cancel_requested)
+    {
+        resuming.swap(ready);
+        for (parked p : resuming)
+        {
+            if (cancel_requested)
+            {
+                break;
+            }
+            resume(p);
+        }
+        resuming.clear();
+    }
+    in_update = false;
+
+    if (cancel_requested)
+    {
+        destroy_all();
+    }
+}
+
+void task_scheduler::cancel_all()
+{
+    if (in_update)
+    {
+        cancel_requested = true;
+        return;
+    }
+    destroy_all();
+}
+
+void task_scheduler::park(const task_wait& w, std::coroutine_handle<> h)
+{
+    const parked p{h, w.task};
+    switch (w.kind)
+    {
+    case task_wait::wk_now:
+        ready.push_back(p);
+        break;
+    case task_wait::wk_frame:
+        timers.schedule(static_cast<uint32_t>(w.target), p);
+        break;
+    case task_wait::wk_event:
+        assert(w.event < MAX_EVENTS);
+        assert(events[w.event].waiters.empty() || events[w.event].waiters.back().target <= w.target);
+        events[w.event].waiters.push_back({w.target, p});
+        break;
+    }
+}
+
+void task_scheduler::resume(parked p)
+{
+    p.h.resume();
+    finish_if_done(p.task);
+}
+
+void task_scheduler::finish_if_done(uint32_t task)
+{
+    if (tasks[task].h && tasks[task].done())
+    {
+        tasks[task].reset();
+        free_tasks.push_back(task);
+    }
+}
+
+void task_scheduler::destroy_all()
+{
+    // a suspended script owns whatever it's awaiting, so destroying the outermost frames is enough
+    for (npc_task& t : tasks)
+    {
+        t.reset();
+    }
+    tasks.clear();
+    free_tasks.clear();
+    timers.cancel_scope(0);
+    for (event_state& e : events)
+    {
+        e.waiters.clear();
+    }
+    ready.clear();
+    resuming.clear();
+    cancel_requested = false;
+}
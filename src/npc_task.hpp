@@ -0,0 +1,278 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <utility>
+#include <vector>
+
+#include "timer_wheel.hpp"
+
+// Script coroutine frames are small and come and go all the time, so they're carved out of
+// per-size free lists rather than the general heap. Main thread only.
+struct task_frame_pool
+{
+    static void* allocate(size_t size);
+    static void release(void* p, size_t size);
+};
+
+// A script coroutine. It starts suspended; task_scheduler::start runs it. Awaiting one npc_task
+// from another runs it to completion as part of the awaiting script.
+class [[nodiscard]] npc_task
+{
+public:
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation;
+
+        npc_task get_return_object()
+        {
+            return npc_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct final_awaiter
+            {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                {
+                    std::coroutine_handle<> c = h.promise().continuation;
+                    return c ? c : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+            return final_awaiter{};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+
+        static void* operator new(size_t size)
+        {
+            return task_frame_pool::allocate(size);
+        }
+
+        static void operator delete(void* p, size_t size)
+        {
+            task_frame_pool::release(p, size);
+        }
+    };
+
+    npc_task() = default;
+
+    npc_task(npc_task&& other) noexcept
+        : h{std::exchange(other.h, {})}
+    {
+    }
+
+    npc_task& operator=(npc_task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            h = std::exchange(other.h, {});
+        }
+        return *this;
+    }
+
+    ~npc_task()
+    {
+        reset();
+    }
+
+    bool done() const
+    {
+        return !h || h.done();
+    }
+
+    bool await_ready() const noexcept
+    {
+        return done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        h.promise().continuation = awaiting;
+        return h;
+    }
+
+    void await_resume() const noexcept {}
+
+private:
+    friend class task_scheduler;
+
+    explicit npc_task(std::coroutine_handle<promise_type> handle)
+        : h{handle}
+    {
+    }
+
+    void reset()
+    {
+        if (h)
+        {
+            h.destroy();
+            h = {};
+        }
+    }
+
+    std::coroutine_handle<promise_type> h;
+};
+
+class task_scheduler;
+
+// What a script co_awaits on: a frame, a count of some event, or nothing at all. Resumes with
+// whatever result the host gave it (for example whether a step could be taken).
+struct task_wait
+{
+    enum wait_kind : uint8_t
+    {
+        wk_now,
+        wk_frame,
+        wk_event,
+    };
+
+    task_scheduler* scheduler;
+    uint32_t task;
+    wait_kind kind;
+    uint32_t event;
+    uint64_t target; // frame or event count
+    bool result;
+
+    bool await_ready() const noexcept;
+    void await_suspend(std::coroutine_handle<> h);
+
+    bool await_resume() const noexcept
+    {
+        return result;
+    }
+};
+
+// Runs script coroutines. Suspended scripts sit in the timer wheel or in a per-event queue and
+// aren't looked at again until what they wait for has happened; only those are resumed.
+class task_scheduler
+{
+public:
+    static constexpr uint32_t MAX_EVENTS = 4;
+
+    task_scheduler() = default;
+    task_scheduler(const task_scheduler&) = delete;
+    task_scheduler& operator=(const task_scheduler&) = delete;
+
+    ~task_scheduler()
+    {
+        cancel_all();
+    }
+
+    // the ID the next script will run as; scripts need it before they exist to build their context
+    uint32_t reserve();
+
+    // runs the script until it first suspends
+    void start(uint32_t task, npc_task t);
+
+    task_wait now(uint32_t task, bool result = true)
+    {
+        return {this, task, task_wait::wk_now, 0, 0, result};
+    }
+
+    task_wait until_frame(uint32_t task, uint32_t frame, bool result = true)
+    {
+        return {this, task, task_wait::wk_frame, 0, frame, result};
+    }
+
+    // resumes once event has been signalled count times in total
+    task_wait until_event(uint32_t task, uint32_t event, uint64_t count)
+    {
+        return {this, task, task_wait::wk_event, event, count, true};
+    }
+
+    uint64_t event_count(uint32_t event) const
+    {
+        return events[event].count;
+    }
+
+    void signal(uint32_t event);
+
+    // fires due timers and resumes everything that's ready
+    void update(uint32_t frame);
+
+    // destroys every running script; deferred until the current update if called from a script
+    void cancel_all();
+
+    size_t running() const
+    {
+        return tasks.size() - free_tasks.size();
+    }
+
+private:
+    friend struct task_wait;
+
+    struct parked
+    {
+        std::coroutine_handle<> h;
+        uint32_t task = 0;
+    };
+
+    struct event_waiter
+    {
+        uint64_t target;
+        parked p;
+    };
+
+    struct event_state
+    {
+        uint64_t count = 0;
+        // targets only ever grow, so waiters stay sorted
+        std::deque<event_waiter> waiters;
+    };
+
+    void park(const task_wait& w, std::coroutine_handle<> h);
+    void resume(parked p);
+    void finish_if_done(uint32_t task);
+    void destroy_all();
+
+    std::vector<npc_task> tasks;
+    std::vector<uint32_t> free_tasks;
+    timer_wheel<parked> timers;
+    event_state events[MAX_EVENTS];
+    std::vector<parked> ready;
+    std::vector<parked> resuming;
+    uint32_t current_frame = 0;
+    bool in_update = false;
+    bool cancel_requested = false;
+};
+
+inline bool task_wait::await_ready() const noexcept
+{
+    switch (kind)
+    {
+    case wk_now:
+        return true;
+    case wk_frame:
+        return target <= scheduler->current_frame;
+    case wk_event:
+        return target <= scheduler->events[event].count;
+    }
+    return true;
+}
+
+inline void task_wait::await_suspend(std::coroutine_handle<> h)
+{
+    scheduler->park(*this, h);
+}
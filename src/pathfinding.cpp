@@ -0,0 +1,315 @@
+#include "pathfinding.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+constexpr int DX[] = {1, 0, -1, 0}; // right, up, left, down
+constexpr int DY[] = {0, -1, 0, 1};
+
+int sign(int v)
+{
+    return (v > 0) - (v < 0);
+}
+} // namespace
+
+uint8_t tile_exits(const tilemap& map, uint32_t x, uint32_t y)
+{
+    // walls can't be entered from anywhere, so nothing can stand on them
+    if (!map.valid(x, y) || (map.collides_from(x, y, right) && map.collides_from(x, y, up) && map.collides_from(x, y, left) && map.collides_from(x, y, down)))
+    {
+        return TILE_BLOCKED;
+    }
+
+    uint8_t e = 0;
+    for (int d = 0; d < 4; ++d)
+    {
+        uint32_t tx = x + DX[d];
+        uint32_t ty = y + DY[d];
+        direction dir = static_cast<direction>(d);
+        if (map.valid(tx, ty) && !map.collides_from(tx, ty, invert(dir)) && map.can_move_from(x, y, dir))
+        {
+            e |= 1 << d;
+        }
+    }
+    return e;
+}
+
+void pathfinder::attach(const tilemap& map)
+{
+    width = map.width;
+    height = map.height;
+    exits.resize(static_cast<size_t>(width) * height);
+    nodes.clear();
+    generation = 0;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            exits[y * width + x] = tile_exits(map, x, y);
+        }
+    }
+
+    uniform = true;
+    for (uint32_t y = 0; y < height && uniform; ++y)
+    {
+        for (uint32_t x = 0; x < width && uniform; ++x)
+        {
+            if (!passable(x, y))
+            {
+                continue;
+            }
+
+            for (int d = 0; d < 4; ++d)
+            {
+                bool open_grid = passable(x + DX[d], y + DY[d]);
+                if (can_step(x, y, static_cast<direction>(d)) != open_grid)
+                {
+                    uniform = false;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool pathfinder::find_path(uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, std::vector<direction>& steps)
+{
+    if (from_x >= width || from_y >= height || to_x >= width || to_y >= height)
+    {
+        return false;
+    }
+
+    const uint32_t start = from_y * width + from_x;
+    const uint32_t goal = to_y * width + to_x;
+    if (exits[start] == BLOCKED || exits[goal] == BLOCKED)
+    {
+        return false;
+    }
+
+    goal_x = to_x;
+    goal_y = to_y;
+    if (!search(start, goal))
+    {
+        return false;
+    }
+
+    append_steps(goal, steps);
+    return true;
+}
+
+void pathfinder::find_paths(std::span<const path_request> requests, std::span<path_result> results, std::vector<direction>& steps)
+{
+    assert(results.size() >= requests.size());
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const path_request& r = requests[i];
+        path_result& out = results[i];
+        out.first_step = static_cast<uint32_t>(steps.size());
+        out.found = find_path(r.from_x, r.from_y, r.to_x, r.to_y, steps);
+        out.step_count = static_cast<uint32_t>(steps.size()) - out.first_step;
+    }
+}
+
+void pathfinder::begin_query()
+{
+    if (nodes.size() != exits.size())
+    {
+        nodes.assign(exits.size(), node{});
+        generation = 0;
+    }
+
+    if (++generation == 0)
+    {
+        // stamps wrapped around, so old ones could pass for current
+        std::fill(nodes.begin(), nodes.end(), node{});
+        generation = 1;
+    }
+
+    open.clear();
+    expanded = 0;
+}
+
+pathfinder::node& pathfinder::visit(uint32_t index)
+{
+    node& n = nodes[index];
+    if (n.stamp != generation)
+    {
+        n = {generation, UINT32_MAX, NO_NODE, false};
+    }
+    return n;
+}
+
+void pathfinder::push(uint32_t index, uint32_t parent, uint32_t g)
+{
+    node& n = visit(index);
+    if (n.closed || g >= n.g)
+    {
+        return;
+    }
+
+    n.g = g;
+    n.parent = parent;
+    open.push_back({g + heuristic(index), g, index});
+    std::push_heap(open.begin(), open.end(), open_after);
+}
+
+bool pathfinder::search(uint32_t start, uint32_t goal)
+{
+    begin_query();
+    push(start, NO_NODE, 0);
+
+    while (open.size())
+    {
+        std::pop_heap(open.begin(), open.end(), open_after);
+        const open_entry e = open.back();
+        open.pop_back();
+
+        // stale entries are left behind when a node's cost drops
+        node& n = nodes[e.index];
+        if (n.closed || e.g != n.g)
+        {
+            continue;
+        }
+        n.closed = true;
+        ++expanded;
+
+        if (e.index == goal)
+        {
+            return true;
+        }
+
+        if (uniform)
+        {
+            expand_jump(e.index, goal);
+        }
+        else
+        {
+            expand_astar(e.index);
+        }
+    }
+
+    return false;
+}
+
+void pathfinder::expand_astar(uint32_t current)
+{
+    const uint32_t g = nodes[current].g + 1;
+    const uint8_t e = exits[current];
+    for (int d = 0; d < 4; ++d)
+    {
+        if (e & (1 << d))
+        {
+            push(current + DY[d] * static_cast<int>(width) + DX[d], current, g);
+        }
+    }
+}
+
+void pathfinder::expand_jump(uint32_t current, uint32_t goal)
+{
+    const int x = static_cast<int>(current % width);
+    const int y = static_cast<int>(current / width);
+    const node& n = nodes[current];
+    const uint32_t g = n.g;
+
+    // only the directions an optimal path could continue in; with no parent that's all four
+    int dirs[4][2];
+    int dir_count = 0;
+    if (n.parent == NO_NODE)
+    {
+        for (int d = 0; d < 4; ++d)
+        {
+            dirs[d][0] = DX[d];
+            dirs[d][1] = DY[d];
+        }
+        dir_count = 4;
+    }
+    else
+    {
+        const int dx = sign(x - static_cast<int>(n.parent % width));
+        const int dy = sign(y - static_cast<int>(n.parent / width));
+        if (dx != 0)
+        {
+            dirs[0][0] = dx, dirs[0][1] = 0;
+            dirs[1][0] = 0, dirs[1][1] = -1;
+            dirs[2][0] = 0, dirs[2][1] = 1;
+        }
+        else
+        {
+            dirs[0][0] = 0, dirs[0][1] = dy;
+            dirs[1][0] = -1, dirs[1][1] = 0;
+            dirs[2][0] = 1, dirs[2][1] = 0;
+        }
+        dir_count = 3;
+    }
+
+    for (int i = 0; i < dir_count; ++i)
+    {
+        uint32_t j = jump(x, y, dirs[i][0], dirs[i][1], goal);
+        if (j != NO_NODE)
+        {
+            const int jx = static_cast<int>(j % width);
+            const int jy = static_cast<int>(j / width);
+            push(j, current, g + static_cast<uint32_t>(std::abs(jx - x) + std::abs(jy - y)));
+        }
+    }
+}
+
+// walks from x, y in a straight line until something interesting: the goal, a tile next to an
+// obstacle that opens up a new way, or (going vertically) a row with something worth jumping to
+uint32_t pathfinder::jump(int x, int y, int dx, int dy, uint32_t goal) const
+{
+    for (;;)
+    {
+        x += dx;
+        y += dy;
+        if (!passable(x, y))
+        {
+            return NO_NODE;
+        }
+
+        const uint32_t i = y * width + x;
+        if (i == goal)
+        {
+            return i;
+        }
+
+        if (dx != 0)
+        {
+            if ((passable(x, y - 1) && !passable(x - dx, y - 1)) || (passable(x, y + 1) && !passable(x - dx, y + 1)))
+            {
+                return i;
+            }
+        }
+        else
+        {
+            if ((passable(x - 1, y) && !passable(x - 1, y - dy)) || (passable(x + 1, y) && !passable(x + 1, y - dy)))
+            {
+                return i;
+            }
+
+            if (jump(x, y, 1, 0, goal) != NO_NODE || jump(x, y, -1, 0, goal) != NO_NODE)
+            {
+                return i;
+            }
+        }
+    }
+}
+
+void pathfinder::append_steps(uint32_t goal, std::vector<direction>& steps) const
+{
+    // parents are jump points when searching with them, so fill in the straight runs between
+    const size_t first = steps.size();
+    for (uint32_t i = goal; nodes[i].parent != NO_NODE; i = nodes[i].parent)
+    {
+        const uint32_t p = nodes[i].parent;
+        const int dx = static_cast<int>(i % width) - static_cast<int>(p % width);
+        const int dy = static_cast<int>(i / width) - static_cast<int>(p / width);
+        const direction d = dx > 0 ? right : dx < 0 ? left : dy < 0 ? up : down;
+        const int count = std::abs(dx) + std::abs(dy);
+        steps.insert(steps.end(), count, d);
+    }
+    std::reverse(steps.begin() + first, steps.end());
+}
@@ -1,158 +1,135 @@
 #pragma once
 
-#include <algorithm>
 #include <cstdint>
-#include <deque>
-#include <optional>
-#include <set>
-#include <unordered_map>
-#include <unordered_set>
+#include <span>
+#include <vector>
 
-#include "mathutil.hpp"
-#include "world.hpp"
+#include "direction.hpp"
+#include "tilemap.hpp"
 
-struct point
+struct path_request
 {
-    int x, y;
-    bool operator==(const point& rhs) const
-    {
-        return x == rhs.x && y == rhs.y;
-    }
-    point left() const { return {x - 1, y}; }
-    point right() const { return {x + 1, y}; }
-    point up() const { return {x, y - 1}; }
-    point down() const { return {x, y + 1}; }
+    uint32_t from_x, from_y;
+    uint32_t to_x, to_y;
 };
-namespace std
+
+// tile_exits of a tile nothing can stand on, as opposed to one with no exits
+constexpr uint8_t TILE_BLOCKED = 0x80;
+
+// which of its four neighbours x, y can be left towards, one bit per direction, or TILE_BLOCKED;
+// the same rules as st_play's try_move_ent
+uint8_t tile_exits(const tilemap& map, uint32_t x, uint32_t y);
+
+// steps of a found path live in the step buffer passed to find_paths
+struct path_result
 {
-template <>
-struct hash<point>
+    bool found = false;
+    uint32_t first_step = 0;
+    uint32_t step_count = 0;
+};
+
+// Grid pathfinding over a tilemap's collision data. attach() bakes which of its four neighbours
+// every tile can be left towards; after that queries only touch flat per-tile arrays. Search
+// state is stamped with a generation instead of being cleared between queries.
+//
+// Maps without one-way tiles use jump point search, which skips over open floor; anything
+// else falls back to plain A*. Entities aren't considered, only tiles.
+class pathfinder
 {
-    size_t operator()(const point& p) const
+public:
+    // rebuilds the passability grid; call again whenever the map changes
+    void attach(const tilemap& map);
+
+    uint32_t get_width() const
     {
-        return p.x + (p.y << 16);
+        return width;
     }
-};
-} // namespace std
 
-struct tile_info
-{
-    int dist = INT_MAX;
-    std::optional<point> prev;
-};
+    uint32_t get_height() const
+    {
+        return height;
+    }
 
-struct score_map : private std::unordered_map<point, int>
-{
-    int get(const point& p)
+    bool uses_jump_points() const
     {
-        if (auto it = find(p); it != end())
-        {
-            return it->second;
-        }
-        else
-        {
-            return INT_MAX - 10000;
-        }
+        return uniform;
     }
 
-    void set(const point& p, int val)
+    // whether a single step from x, y in direction d is allowed
+    bool can_step(uint32_t x, uint32_t y, direction d) const
     {
-        operator[](p) = val;
+        return x < width && y < height && (exits[y * width + x] & (1 << d));
     }
-};
 
-using path_map = std::unordered_map<point, point>;
-using path_seq = std::deque<point>;
+    // steps taking from_x, from_y to to_x, to_y; returns false and leaves steps alone if there's
+    // no way there
+    bool find_path(uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y, std::vector<direction>& steps);
 
-inline path_seq reconstruct_path(const path_map& came_from, point current)
-{
-    path_seq total_path{current};
-    path_map::const_iterator it;
-    for (;;)
+    // solves every request in turn, appending all steps to one buffer. the search arrays are
+    // shared, so this is the cheap way to run lots of queries in one tick.
+    void find_paths(std::span<const path_request> requests, std::span<path_result> results, std::vector<direction>& steps);
+
+    // nodes popped off the open list by the last query
+    uint32_t last_expanded() const
     {
-        it = came_from.find(current);
-        if (it == came_from.end())
-            break;
-        current = it->second;
-        total_path.push_front(current);
+        return expanded;
     }
-    return total_path;
-}
 
-inline path_seq find_path(world& wor, int x0, int y0, int x1, int y1)
-{
-    int width = (int)wor.tiles.get_width();
-
-    point start{x0, y0};
-    point end{x1, y1};
-
-    std::unordered_set<point> frontier_set;
-    std::vector<point> frontier;
-    frontier.push_back(start);
-
-    std::unordered_map<point, point> came_from;
-    score_map g_score;
-    g_score.set(start, 0);
-    score_map f_score;
-    f_score.set(start, 0);
-
-    auto check_adjacent_point = [&](const point& from, const point& to) {
-        if (!wor.tiles.is_valid_index(to.x, to.y))
-        {
-            return;
-        }
-
-        // d(current, neighbor) is always 1
-        int tentative_g_score = g_score.get(from) + 1;
-        if (tentative_g_score < g_score.get(to))
-        {
-            came_from[to] = from;
-            g_score.set(to, tentative_g_score);
-            f_score.set(to, tentative_g_score + manhattan(to.x, to.y, end.x, end.y));
-
-            if (!frontier_set.count(to))
-            {
-                frontier.push_back(to);
-                frontier_set.insert(to);
-                std::push_heap(frontier.begin(), frontier.end(), [&](const point& left, const point& right) {
-                    return f_score.get(left) > f_score.get(right);
-                });
-            }
-        }
+private:
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    struct node
+    {
+        uint32_t stamp = 0;
+        uint32_t g = 0;
+        uint32_t parent = NO_NODE;
+        bool closed = false;
     };
 
-    while (frontier.size())
+    struct open_entry
     {
-        // std::sort(frontier.begin(), frontier.end(), [&](const point& left, const point& right) {
-        //     return f_score.get(left) > f_score.get(right);
-        // });
+        uint32_t f;
+        uint32_t g;
+        uint32_t index;
+    };
 
-        point current = frontier.front();
-        std::pop_heap(frontier.begin(), frontier.end(), [&](const point& left, const point& right) {
-            return f_score.get(left) > f_score.get(right);
-        });
-        frontier.pop_back();
+    // min f first, and among equal f the node furthest along
+    static bool open_after(const open_entry& a, const open_entry& b)
+    {
+        return a.f > b.f || (a.f == b.f && a.g < b.g);
+    }
 
-        if (current == end)
-        {
-            return reconstruct_path(came_from, current);
-        }
+    bool passable(int x, int y) const
+    {
+        return x >= 0 && y >= 0 && static_cast<uint32_t>(x) < width && static_cast<uint32_t>(y) < height && exits[y * width + x] != BLOCKED;
+    }
 
-        // inspect adjacent tiles
-        point L = current.left();
-        check_adjacent_point(current, L);
+    void begin_query();
+    node& visit(uint32_t index);
+    void push(uint32_t index, uint32_t parent, uint32_t g);
+    bool search(uint32_t start, uint32_t goal);
+    void expand_astar(uint32_t current);
+    void expand_jump(uint32_t current, uint32_t goal);
+    uint32_t jump(int x, int y, int dx, int dy, uint32_t goal) const;
+    void append_steps(uint32_t goal, std::vector<direction>& steps) const;
 
-        point R = current.right();
-        check_adjacent_point(current, R);
+    uint32_t heuristic(uint32_t index) const
+    {
+        uint32_t x = index % width;
+        uint32_t y = index / width;
+        return (x > goal_x ? x - goal_x : goal_x - x) + (y > goal_y ? y - goal_y : goal_y - y);
+    }
 
-        point U = current.up();
-        check_adjacent_point(current, U);
+    static constexpr uint8_t BLOCKED = TILE_BLOCKED;
 
-        point D = current.down();
-        check_adjacent_point(current, D);
-    }
+    uint32_t width = 0, height = 0;
+    std::vector<uint8_t> exits;
+    // every step between two standable tiles is allowed, which jump point search relies on
+    bool uniform = false;
 
-    // should probably log a warning here or something
-    assert(false);
-    return {};
-}
\ No newline at end of file
+    std::vector<node> nodes;
+    std::vector<open_entry> open;
+    uint32_t generation = 0;
+    uint32_t goal_x = 0, goal_y = 0;
+    uint32_t expanded = 0;
+};
@@ -0,0 +1,426 @@
+#include "portal_graph.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <utility>
+
+#include "world.hpp"
+
+namespace
+{
+constexpr int DX[] = {1, 0, -1, 0}; // right, up, left, down
+constexpr int DY[] = {0, -1, 0, 1};
+
+uint32_t distance_between(uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y)
+{
+    return (from_x > to_x ? from_x - to_x : to_x - from_x) + (from_y > to_y ? from_y - to_y : to_y - from_y);
+}
+} // namespace
+
+uint32_t portal_graph::map_info::region_at(uint32_t x, uint32_t y) const
+{
+    if (x >= width || y >= height)
+    {
+        return 0;
+    }
+
+    auto first = region_runs.begin() + region_rows[y];
+    auto last = region_runs.begin() + region_rows[y + 1];
+    return std::lower_bound(first, last, x, [](const region_run& r, uint32_t v) { return r.last_x < v; })->region;
+}
+
+uint32_t portal_graph::map_index(const std::string& name) const
+{
+    auto it = map_indices.find(name);
+    return it != map_indices.end() ? it->second : UINT32_MAX;
+}
+
+uint32_t portal_graph::find_route(pathfinder& here, uint32_t from_map, uint32_t from_x, uint32_t from_y, uint32_t to_map, uint32_t to_x, uint32_t to_y, std::vector<route_leg>& legs)
+{
+    legs.clear();
+    if (from_map >= maps.size() || to_map >= maps.size())
+    {
+        return UNREACHABLE;
+    }
+
+    const uint32_t start_region = maps[from_map].region_at(from_x, from_y);
+    const uint32_t goal_region = maps[to_map].region_at(to_x, to_y);
+    if (start_region == 0 || goal_region == 0)
+    {
+        return UNREACHABLE;
+    }
+
+    // NO_NODE as the last node means walking straight there without the graph
+    uint32_t best = UNREACHABLE;
+    uint32_t best_last = NO_NODE;
+    if (from_map == to_map && start_region == goal_region)
+    {
+        best = walk_cost(here, from_map, from_map, from_x, from_y, to_x, to_y);
+    }
+
+    cost.assign(nodes.size(), UNREACHABLE);
+    came_from.assign(nodes.size(), NO_NODE);
+    came_by_portal.assign(nodes.size(), false);
+    cost_to_goal.assign(nodes.size(), UNREACHABLE);
+    open.clear();
+
+    // the two ends aren't nodes, so join them to the nodes of their regions for this query
+    for (uint32_t n : maps[to_map].nodes)
+    {
+        if (nodes[n].region == goal_region)
+        {
+            cost_to_goal[n] = walk_cost(here, from_map, to_map, nodes[n].x, nodes[n].y, to_x, to_y);
+        }
+    }
+
+    for (uint32_t n : maps[from_map].nodes)
+    {
+        if (nodes[n].region != start_region)
+        {
+            continue;
+        }
+
+        cost[n] = walk_cost(here, from_map, from_map, from_x, from_y, nodes[n].x, nodes[n].y);
+        if (cost[n] != UNREACHABLE)
+        {
+            open.push_back({cost[n], n});
+            std::push_heap(open.begin(), open.end(), open_after);
+        }
+    }
+
+    while (open.size())
+    {
+        std::pop_heap(open.begin(), open.end(), open_after);
+        const open_entry e = open.back();
+        open.pop_back();
+
+        if (e.cost != cost[e.node])
+        {
+            continue;
+        }
+
+        if (e.cost >= best)
+        {
+            break;
+        }
+
+        if (cost_to_goal[e.node] != UNREACHABLE && e.cost + cost_to_goal[e.node] < best)
+        {
+            best = e.cost + cost_to_goal[e.node];
+            best_last = e.node;
+        }
+
+        for (uint32_t i = edge_start[e.node]; i < edge_start[e.node + 1]; ++i)
+        {
+            const graph_edge& edge = edges[i];
+            const uint32_t c = e.cost + edge.cost;
+            if (c < cost[edge.to])
+            {
+                cost[edge.to] = c;
+                came_from[edge.to] = e.node;
+                came_by_portal[edge.to] = edge.portal;
+                open.push_back({c, edge.to});
+                std::push_heap(open.begin(), open.end(), open_after);
+            }
+        }
+    }
+
+    if (best == UNREACHABLE)
+    {
+        return UNREACHABLE;
+    }
+
+    // walk back through the nodes, then turn every stretch between portals into a leg
+    chain.clear();
+    for (uint32_t n = best_last; n != NO_NODE; n = came_from[n])
+    {
+        chain.push_back(n);
+    }
+    std::reverse(chain.begin(), chain.end());
+
+    uint32_t map = from_map;
+    uint32_t x = from_x, y = from_y;
+    auto walk_to = [&](uint32_t tx, uint32_t ty) {
+        if (tx != x || ty != y)
+        {
+            legs.push_back({map, x, y, tx, ty});
+        }
+        x = tx;
+        y = ty;
+    };
+
+    for (uint32_t n : chain)
+    {
+        if (came_by_portal[n])
+        {
+            map = nodes[n].map;
+            x = nodes[n].x;
+            y = nodes[n].y;
+        }
+        else
+        {
+            walk_to(nodes[n].x, nodes[n].y);
+        }
+    }
+    walk_to(to_x, to_y);
+
+    return best;
+}
+
+bool portal_graph::refine(pathfinder& paths, const route_leg& leg, std::vector<direction>& steps) const
+{
+    assert(leg.map < maps.size() && paths.get_width() == maps[leg.map].width && paths.get_height() == maps[leg.map].height);
+    return paths.find_path(leg.from_x, leg.from_y, leg.to_x, leg.to_y, steps);
+}
+
+size_t portal_graph::memory_usage() const
+{
+    size_t bytes = sizeof(portal_graph);
+    for (const map_info& m : maps)
+    {
+        bytes += sizeof(map_info) + m.name.capacity() + m.region_rows.capacity() * sizeof(uint32_t);
+        bytes += m.region_runs.capacity() * sizeof(region_run) + m.nodes.capacity() * sizeof(uint32_t);
+    }
+    bytes += nodes.capacity() * sizeof(graph_node) + edge_start.capacity() * sizeof(uint32_t) + edges.capacity() * sizeof(graph_edge);
+    return bytes;
+}
+
+// the graph's own costs are exact, walking where the traveller isn't yet is a guess
+uint32_t portal_graph::walk_cost(pathfinder& here, uint32_t here_map, uint32_t map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y)
+{
+    if (map != here_map)
+    {
+        return distance_between(from_x, from_y, to_x, to_y);
+    }
+
+    scratch.clear();
+    if (!here.find_path(from_x, from_y, to_x, to_y, scratch))
+    {
+        return UNREACHABLE;
+    }
+    return static_cast<uint32_t>(scratch.size());
+}
+
+portal_graph_builder::portal_graph_builder(const std::string& first_map)
+{
+    graph.map_indices.emplace(first_map, 0);
+    graph.maps.emplace_back().name = first_map;
+}
+
+bool portal_graph_builder::step()
+{
+    if (done)
+    {
+        return true;
+    }
+
+    // breadth first through the portals; maps are appended as they're discovered
+    if (!walking)
+    {
+        discover(next_map++);
+        if (next_map == graph.maps.size())
+        {
+            link_portals();
+            walking = true;
+            next_map = 0;
+        }
+        return false;
+    }
+
+    walk(next_map++);
+    if (next_map == graph.maps.size())
+    {
+        finish();
+        done = true;
+    }
+    return done;
+}
+
+portal_graph portal_graph_builder::take()
+{
+    assert(done);
+    return std::move(graph);
+}
+
+void portal_graph_builder::discover(uint32_t map)
+{
+    world w = load_world(std::format("assets/maps/{}.bin", graph.maps[map].name));
+
+    std::unordered_map<std::string, tile_pos>& named = named_tiles.emplace_back();
+    for (const entity& e : *w.ents)
+    {
+        named.emplace(e.name, tile_pos{e.tile_x(), e.tile_y()});
+        if (e.get_type() != et_portal)
+        {
+            continue;
+        }
+
+        auto [it, added] = graph.map_indices.emplace(e.portal_state.exit_map, static_cast<uint32_t>(graph.maps.size()));
+        if (added)
+        {
+            graph.maps.emplace_back().name = e.portal_state.exit_map;
+        }
+        portals.push_back({add_node(map, e.tile_x(), e.tile_y()), it->second, e.portal_state.exit_name});
+    }
+}
+
+void portal_graph_builder::link_portals()
+{
+    for (const pending_portal& p : portals)
+    {
+        auto it = named_tiles[p.exit_map].find(p.exit_name);
+        if (it == named_tiles[p.exit_map].end())
+        {
+            continue;
+        }
+
+        uint32_t exit = add_node(p.exit_map, it->second.x, it->second.y);
+        adjacency.resize(graph.nodes.size());
+        adjacency[p.node].push_back({exit, 0, true});
+    }
+    adjacency.resize(graph.nodes.size());
+
+    portals = {};
+    named_tiles = {};
+}
+
+// the expensive part, but maps only have a handful of nodes each
+void portal_graph_builder::walk(uint32_t map)
+{
+    portal_graph::map_info& m = graph.maps[map];
+    {
+        world w = load_world(std::format("assets/maps/{}.bin", m.name));
+        paths.attach(w.map);
+    }
+    label_regions(m);
+
+    for (uint32_t n : m.nodes)
+    {
+        graph.nodes[n].region = m.region_at(graph.nodes[n].x, graph.nodes[n].y);
+    }
+
+    std::vector<direction> steps;
+    for (uint32_t a : m.nodes)
+    {
+        for (uint32_t b : m.nodes)
+        {
+            const portal_graph::graph_node& from = graph.nodes[a];
+            const portal_graph::graph_node& to = graph.nodes[b];
+            if (a == b || from.region != to.region || from.region == 0)
+            {
+                continue;
+            }
+
+            steps.clear();
+            if (paths.find_path(from.x, from.y, to.x, to.y, steps))
+            {
+                adjacency[a].push_back({b, static_cast<uint32_t>(steps.size()), false});
+            }
+        }
+    }
+}
+
+void portal_graph_builder::finish()
+{
+    graph.edge_start.assign(1, 0);
+    graph.edges.clear();
+    for (const std::vector<portal_graph::graph_edge>& out : adjacency)
+    {
+        graph.edges.insert(graph.edges.end(), out.begin(), out.end());
+        graph.edge_start.push_back(static_cast<uint32_t>(graph.edges.size()));
+    }
+
+    adjacency = {};
+    paths = {};
+    regions = {};
+}
+
+uint32_t portal_graph_builder::add_node(uint32_t map, uint32_t x, uint32_t y)
+{
+    for (uint32_t n : graph.maps[map].nodes)
+    {
+        if (graph.nodes[n].x == x && graph.nodes[n].y == y)
+        {
+            return n;
+        }
+    }
+
+    // regions aren't known until the map is walked
+    const uint32_t n = static_cast<uint32_t>(graph.nodes.size());
+    graph.nodes.push_back({map, x, y, 0});
+    graph.maps[map].nodes.push_back(n);
+    return n;
+}
+
+// flood fills tiles joined by a step in either direction, so a region is everything that might
+// be reachable from anywhere in it; one-way tiles can still make some of it a dead end. the
+// labels go into a scratch array that's then squeezed into runs per row.
+void portal_graph_builder::label_regions(portal_graph::map_info& m)
+{
+    const uint32_t width = paths.get_width();
+    const uint32_t height = paths.get_height();
+    regions.assign(static_cast<size_t>(width) * height, 0);
+
+    auto joined = [&](uint32_t x, uint32_t y, int d) {
+        const direction dir = static_cast<direction>(d);
+        return paths.can_step(x, y, dir) || paths.can_step(x + DX[d], y + DY[d], invert(dir));
+    };
+
+    uint32_t next_region = 1;
+    std::vector<uint32_t> stack;
+    for (uint32_t start = 0; start < regions.size(); ++start)
+    {
+        const uint32_t sx = start % width;
+        const uint32_t sy = start / width;
+        if (regions[start] != 0 || !(joined(sx, sy, 0) || joined(sx, sy, 1) || joined(sx, sy, 2) || joined(sx, sy, 3)))
+        {
+            continue;
+        }
+
+        regions[start] = next_region;
+        stack.push_back(start);
+        while (stack.size())
+        {
+            const uint32_t c = stack.back();
+            stack.pop_back();
+            const uint32_t x = c % width;
+            const uint32_t y = c / width;
+            for (int d = 0; d < 4; ++d)
+            {
+                if (!joined(x, y, d))
+                {
+                    continue;
+                }
+
+                const uint32_t n = (y + DY[d]) * width + x + DX[d];
+                if (regions[n] == 0)
+                {
+                    regions[n] = next_region;
+                    stack.push_back(n);
+                }
+            }
+        }
+        ++next_region;
+    }
+
+    m.width = width;
+    m.height = height;
+    m.region_rows.clear();
+    m.region_runs.clear();
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        m.region_rows.push_back(static_cast<uint32_t>(m.region_runs.size()));
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            const uint32_t r = regions[y * width + x];
+            if (x == 0 || m.region_runs.back().region != r)
+            {
+                m.region_runs.push_back({r, x});
+            }
+            m.region_runs.back().last_x = x;
+        }
+    }
+    m.region_rows.push_back(static_cast<uint32_t>(m.region_runs.size()));
+    m.region_runs.shrink_to_fit();
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pathfinding.hpp"
+
+// one stretch of walking on a single map; crossing to the next leg happens by stepping onto the
+// portal at the end of this one
+struct route_leg
+{
+    uint32_t map;
+    uint32_t from_x, from_y;
+    uint32_t to_x, to_y;
+};
+
+// Abstract graph over every map reachable through portals, for routes that cross maps.
+//
+// Nodes are the tiles that matter for travel between maps: portals, and the tiles portals put
+// you on. Each map is split into regions (areas connected by walkable tiles), and within a map
+// every pair of nodes sharing a region is joined by its walking distance, all computed by
+// portal_graph_builder. A portal is joined to where it leads at no cost. A query searches this
+// small graph and returns one leg per stretch of walking; only the legs themselves need the
+// tile-level pathfinder, and only once the traveller gets to them.
+//
+// Nothing per tile is kept: regions are stored as runs along each row, and the pathfinder for a
+// map is whichever one the game already has for the map the traveller is on.
+class portal_graph
+{
+public:
+    // index of a map in the graph, or UINT32_MAX if the build never reached it
+    uint32_t map_index(const std::string& name) const;
+
+    const std::string& map_name(uint32_t map) const
+    {
+        return maps[map].name;
+    }
+
+    size_t map_count() const
+    {
+        return maps.size();
+    }
+
+    size_t node_count() const
+    {
+        return nodes.size();
+    }
+
+    // finds the cheapest way from a tile on from_map, whose pathfinder here is, to a tile on any
+    // map. walking on to_map is only estimated, by the straight line distance, unless it's
+    // from_map too. legs are replaced; returns the number of steps, or UINT32_MAX (and no legs)
+    // if there's no way there.
+    uint32_t find_route(pathfinder& here, uint32_t from_map, uint32_t from_x, uint32_t from_y, uint32_t to_map, uint32_t to_x, uint32_t to_y, std::vector<route_leg>& legs);
+
+    // turns a leg into single steps through the pathfinder of the leg's map; false if the leg
+    // can't be walked after all
+    bool refine(pathfinder& paths, const route_leg& leg, std::vector<direction>& steps) const;
+
+    // approximate heap footprint
+    size_t memory_usage() const;
+
+private:
+    friend class portal_graph_builder;
+
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+    static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+
+    // tiles up to and including last_x belong to region, 0 for tiles nothing can stand on
+    struct region_run
+    {
+        uint32_t region;
+        uint32_t last_x;
+    };
+
+    struct map_info
+    {
+        std::string name;
+        uint32_t width = 0, height = 0;
+        // the runs of row y are region_runs[region_rows[y]] up to region_runs[region_rows[y + 1]]
+        std::vector<uint32_t> region_rows;
+        std::vector<region_run> region_runs;
+        std::vector<uint32_t> nodes;
+
+        uint32_t region_at(uint32_t x, uint32_t y) const;
+    };
+
+    struct graph_node
+    {
+        uint32_t map;
+        uint32_t x, y;
+        uint32_t region;
+    };
+
+    struct graph_edge
+    {
+        uint32_t to;
+        uint32_t cost;
+        bool portal; // teleports rather than walks
+    };
+
+    struct open_entry
+    {
+        uint32_t cost;
+        uint32_t node;
+    };
+
+    static bool open_after(const open_entry& a, const open_entry& b)
+    {
+        return a.cost > b.cost;
+    }
+
+    uint32_t walk_cost(pathfinder& here, uint32_t here_map, uint32_t map, uint32_t from_x, uint32_t from_y, uint32_t to_x, uint32_t to_y);
+
+    std::vector<map_info> maps;
+    std::unordered_map<std::string, uint32_t> map_indices;
+    std::vector<graph_node> nodes;
+
+    // edges of node i are edges[edge_start[i]] up to edges[edge_start[i + 1]]
+    std::vector<uint32_t> edge_start;
+    std::vector<graph_edge> edges;
+
+    // per query
+    std::vector<uint32_t> cost;
+    std::vector<uint32_t> came_from;
+    std::vector<uint8_t> came_by_portal;
+    std::vector<uint32_t> cost_to_goal;
+    std::vector<open_entry> open;
+    std::vector<uint32_t> chain;
+    std::vector<direction> scratch;
+};
+
+// Builds a portal_graph one map at a time, so map_loader can spread it out between loads. Every
+// reachable map is loaded twice: first to find the portals, which is where the nodes come from,
+// then to label its regions and walk between its nodes. Only the map being worked on has a
+// pathfinder and per tile arrays.
+class portal_graph_builder
+{
+public:
+    explicit portal_graph_builder(const std::string& first_map);
+
+    // loads and works through the next map; true once the graph is done
+    bool step();
+
+    // the finished graph; step() must have returned true
+    portal_graph take();
+
+private:
+    struct tile_pos
+    {
+        uint32_t x, y;
+    };
+
+    // a portal found while discovering; its exit is looked up once every map is known
+    struct pending_portal
+    {
+        uint32_t node;
+        uint32_t exit_map;
+        std::string exit_name;
+    };
+
+    void discover(uint32_t map);
+    void link_portals();
+    void walk(uint32_t map);
+    void finish();
+    uint32_t add_node(uint32_t map, uint32_t x, uint32_t y);
+    void label_regions(portal_graph::map_info& m);
+
+    portal_graph graph;
+
+    bool walking = false;
+    bool done = false;
+    uint32_t next_map = 0;
+
+    std::vector<pending_portal> portals;
+    std::vector<std::unordered_map<std::string, tile_pos>> named_tiles;
+    std::vector<std::vector<portal_graph::graph_edge>> adjacency;
+
+    // for the map being walked
+    pathfinder paths;
+    std::vector<uint32_t> regions;
+};
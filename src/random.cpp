@@ -1,36 +1,107 @@
 #include "random.hpp"
 
-// GLOBAL
-random inst;
+#include <algorithm>
+#include <cmath>
+#include <ctime>
 
-random::random()
+static uint64_t splitmix64(uint64_t& state)
 {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
 }
 
-random& random::instance()
+void rng_stream::seed(uint64_t s)
 {
-    return inst;
+    // splitmix64 never gives a lane the all-zero state xoshiro can't leave
+    for (size_t i = 0; i < LANES; ++i)
+    {
+        const uint64_t a = splitmix64(s);
+        const uint64_t b = splitmix64(s);
+        s0[i] = static_cast<uint32_t>(a);
+        s1[i] = static_cast<uint32_t>(a >> 32);
+        s2[i] = static_cast<uint32_t>(b);
+        s3[i] = static_cast<uint32_t>(b >> 32);
+    }
+    cursor = LANES;
 }
 
-int random::rand_int(int min, int max)
+int rng_stream::rand_poisson(float mean)
 {
-    std::uniform_int_distribution<int> dist{min, max};
-    return dist(inst.dev);
+    if (mean <= 0)
+    {
+        return 0;
+    }
+
+    // counting uniform draws until their product falls below e^-mean gets slow for large means,
+    // where the normal approximation is close enough
+    if (mean > 30)
+    {
+        const float u1 = 1.0f - rand_real();
+        const float u2 = rand_real();
+        const float normal = std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+        return std::max(0, static_cast<int>(std::lround(mean + std::sqrt(mean) * normal)));
+    }
+
+    const float limit = std::exp(-mean);
+    int k = 0;
+    float p = rand_real();
+    while (p > limit)
+    {
+        ++k;
+        p *= rand_real();
+    }
+    return k;
 }
 
-float random::rand_real()
+void rng_stream::fill_u32(uint32_t* out, size_t n)
 {
-    std::uniform_real_distribution<float> dist{};
-    return dist(inst.dev);
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+    {
+        refill(out + i);
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = next_u32();
+    }
 }
 
-float random::rand_real(float min, float max)
+void rng_stream::fill_real(float* out, size_t n, float min, float max)
 {
-    std::uniform_real_distribution<float> dist{min, max};
-    return dist(inst.dev);
+    const float scale = (max - min) * 0x1p-24f;
+    alignas(32) uint32_t bits[LANES];
+
+    size_t i = 0;
+    for (; i + LANES <= n; i += LANES)
+    {
+        refill(bits);
+        for (size_t j = 0; j < LANES; ++j)
+        {
+            out[i + j] = min + static_cast<float>(bits[j] >> 8) * scale;
+        }
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = rand_real(min, max);
+    }
 }
 
-bool random::chance(float rate)
+static std::array<rng_stream, RNG_STREAM_MAX> streams;
+
+void seed_rng_streams(uint64_t seed)
 {
-    return rand_real() <= rate;
-}
\ No newline at end of file
+    for (size_t i = 0; i < streams.size(); ++i)
+    {
+        streams[i].seed(seed ^ (0x9e3779b97f4a7c15ull * (i + 1)));
+    }
+}
+
+static const bool clock_seeded = (seed_rng_streams(static_cast<uint64_t>(time(0))), true);
+
+rng_stream& get_rng(rng_stream_id id)
+{
+    assert(id < RNG_STREAM_MAX);
+    return streams[id];
+}
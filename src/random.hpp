@@ -1,22 +1,124 @@
 #pragma once
 
-#include <ctime>
-#include <random>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 
-struct random
+// xoshiro128+ run as eight interleaved generators. Single draws are handed out of a block of
+// eight outputs that is refilled in one pass over all lanes, which compiles to vector code, and
+// the fill_* functions write whole blocks straight into the caller's array. Draws only use the
+// high bits of an output, which is where xoshiro128+ is strong.
+class rng_stream
 {
 public:
-    random();
+    static constexpr size_t LANES = 8;
 
-    static int rand_int(int min, int max);
-    static float rand_real();
-    static float rand_real(float min, float max);
+    rng_stream()
+    {
+        seed(0);
+    }
 
-    static bool chance(float rate);
+    explicit rng_stream(uint64_t s)
+    {
+        seed(s);
+    }
+
+    // the same seed always gives the same sequence
+    void seed(uint64_t s);
+
+    uint32_t next_u32()
+    {
+        if (cursor == LANES)
+        {
+            refill(block.data());
+            cursor = 0;
+        }
+        return block[cursor++];
+    }
+
+    uint64_t next_u64()
+    {
+        const uint64_t hi = next_u32();
+        return hi << 32 | next_u32();
+    }
+
+    // in [min, max]
+    int rand_int(int min, int max)
+    {
+        assert(min <= max);
+        const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(max) - min) + 1;
+        return static_cast<int>(min + static_cast<int64_t>((next_u32() * range) >> 32));
+    }
+
+    // in [0, 1)
+    float rand_real()
+    {
+        return to_unit(next_u32());
+    }
+
+    // in [min, max)
+    float rand_real(float min, float max)
+    {
+        return min + rand_real() * (max - min);
+    }
+
+    bool chance(float rate)
+    {
+        return rand_real() <= rate;
+    }
+
+    int rand_poisson(float mean);
+
+    void fill_u32(uint32_t* out, size_t n);
+    // n draws of rand_real(min, max)
+    void fill_real(float* out, size_t n, float min, float max);
 
 private:
-    static random& instance();
+    static float to_unit(uint32_t x)
+    {
+        return static_cast<float>(x >> 8) * 0x1p-24f;
+    }
 
-    // std::random_device dev;
-    std::mt19937 dev{(std::mt19937::result_type)time(0)};
+    static uint32_t rotl(uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    void refill(uint32_t* out)
+    {
+        for (size_t i = 0; i < LANES; ++i)
+        {
+            out[i] = s0[i] + s3[i];
+
+            const uint32_t t = s1[i] << 9;
+            s2[i] ^= s0[i];
+            s3[i] ^= s1[i];
+            s1[i] ^= s2[i];
+            s0[i] ^= s3[i];
+            s2[i] ^= t;
+            s3[i] = rotl(s3[i], 11);
+        }
+    }
+
+    alignas(32) std::array<uint32_t, LANES> s0, s1, s2, s3;
+    alignas(32) std::array<uint32_t, LANES> block;
+    uint32_t cursor = LANES;
+};
+
+// Streams for the systems outside of battles, each seeded independently from one seed so
+// one system drawing more or less never shifts what another one gets.
+enum rng_stream_id
+{
+    rng_overworld,
+    rng_foam,
+    rng_encounters,
+    // seeds for each battle_field's own stream
+    rng_battles,
+    RNG_STREAM_MAX,
 };
+
+// reseeds every stream; until this is called they're seeded from the clock
+void seed_rng_streams(uint64_t seed);
+
+rng_stream& get_rng(rng_stream_id id);
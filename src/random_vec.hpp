@@ -4,17 +4,17 @@
 
 #include "random.hpp"
 
-inline glm::vec2 rand_vec2(float min, float max)
+inline glm::vec2 rand_vec2(rng_stream& rng, float min, float max)
 {
-    return {random::rand_real(min, max), random::rand_real(min, max)};
+    return {rng.rand_real(min, max), rng.rand_real(min, max)};
 }
 
-inline glm::vec2 rand_vec2(float minx, float maxx, float miny, float maxy)
+inline glm::vec2 rand_vec2(rng_stream& rng, float minx, float maxx, float miny, float maxy)
 {
-    return {random::rand_real(minx, maxx), random::rand_real(miny, maxy)};
+    return {rng.rand_real(minx, maxx), rng.rand_real(miny, maxy)};
 }
 
-inline glm::vec2 rand_vec2_x(float minx, float maxx)
+inline glm::vec2 rand_vec2_x(rng_stream& rng, float minx, float maxx)
 {
-    return {random::rand_real(minx, maxx), 0};
-}
\ No newline at end of file
+    return {rng.rand_real(minx, maxx), 0};
+}
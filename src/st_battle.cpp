@@ -1,5 +1,6 @@
 #include "st_battle.hpp"
 
+#include <chrono>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/compatibility.hpp>
 
@@ -30,15 +31,6 @@ st_battle::st_battle(game* o, shared_state* s)
 {
 }
 
-sk_flash_jump s_flash_jump;
-sk_double_throw s_double_throw;
-sk_avenger s_avenger;
-
-sk_double_throw s_shadow_double_throw;
-sk_avenger s_shadow_avenger;
-skill* s_shadow_echo = nullptr;
-timer s_shadow_timer;
-
 void load_battle_field_mesh(const battle_field_properties& info, battle_field_mesh& mesh, battle_field_bounds& bounds)
 {
     const std::string filename = std::format("assets/models/{}.bin", info.name);
@@ -87,8 +79,19 @@ void st_battle::init()
     g_audio = state->audio;
 }
 
+static double ms_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 void st_battle::update()
 {
+    if (stress)
+    {
+        update_stress();
+        return;
+    }
+
     if (sub == battle_fadein)
     {
         if (b_fade_timer.expired(state->frame_counter))
@@ -101,8 +104,8 @@ void st_battle::update()
     {
         if (b_fade_timer.expired(state->frame_counter))
         {
-            current_music->volume = 0;
-            current_music->done = true;
+            state->audio->set_volume(current_music, 0);
+            state->audio->stop(current_music);
             if (b_result == win)
             {
                 owner->get_battlestats_state().set_exp_gained(b_field.calc_exp_value());
@@ -116,7 +119,7 @@ void st_battle::update()
         }
         else
         {
-            current_music->volume = 1.0f - static_cast<float>(b_fade_timer.progress(state->frame_counter));
+            state->audio->set_volume(current_music, 1.0f - static_cast<float>(b_fade_timer.progress(state->frame_counter)));
         }
     }
 
@@ -136,23 +139,12 @@ void st_battle::update()
             }
             else
             {
-                // anim.set_animation("down");
+                // anim.set_animation(anim_down);
             }
         }
     }
 
-    s_flash_jump.update(b_field, b_field.player());
-    s_double_throw.update(b_field, b_field.player());
-    s_avenger.update(b_field, b_field.player());
-
-    s_shadow_double_throw.update(b_field, b_field.player());
-    s_shadow_avenger.update(b_field, b_field.player());
-
-    if (s_shadow_echo && s_shadow_timer.expired(state->frame_counter))
-    {
-        b_field.player().use_skill_unconditionally(b_field, s_shadow_echo);
-        s_shadow_echo = nullptr;
-    }
+    kit.update(b_field);
 
     if (sub == none || sub == battle_fadeout)
     {
@@ -173,8 +165,46 @@ void st_battle::update()
     }
 }
 
+void st_battle::update_stress()
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    // the player throws everything they have at a horde that can neither kill them nor die, so
+    // the battle stays the same size all stage
+    b_field.player().life = state->session->stats.max_life();
+    if (b_field.player().can_act())
+    {
+        kit.throw_knives(b_field);
+        kit.throw_avenger(b_field);
+    }
+
+    b_field.update(false);
+    kit.update(b_field);
+
+    b_cam.set_target(b_field.player().pos + glm::vec2(0, 8));
+    b_cam.update();
+
+    stress->record_tick(ms_since(start), b_field);
+
+    if (stress->end_stage())
+    {
+        if (stress->finished())
+        {
+            SDL_Event quit{};
+            quit.type = SDL_QUIT;
+            SDL_PushEvent(&quit);
+            return;
+        }
+
+        enc = get_horde_encounter(stress->horde_size());
+        begin_battle();
+    }
+}
+
 void st_battle::render(double a)
 {
+    const auto start = std::chrono::steady_clock::now();
+
     glEnable(GL_DEPTH_TEST);
 
     glClearColor(bf_props->sky_color.r, bf_props->sky_color.g, bf_props->sky_color.b, 1.f);
@@ -237,9 +267,9 @@ void st_battle::render(double a)
     {
         auto interp_rect = fx.worldspace_interp_rect(a);
 
-        if (fx.attached())
+        if (const battle_character* fx_owner = b_field.get_character(fx.owner))
         {
-            auto owner_rect = b_field.characters[fx.owner].worldspace_interp_rect(a);
+            auto owner_rect = fx_owner->worldspace_interp_rect(a);
             interp_rect.x += owner_rect.x + owner_rect.w / 2;
             interp_rect.y += owner_rect.y + owner_rect.h / 2;
         }
@@ -262,6 +292,13 @@ void st_battle::render(double a)
 
     render_health_bar();
     render_fade();
+
+    if (stress)
+    {
+        // so the frame's time covers the gpu drawing it, not just handing it over
+        glFinish();
+        stress->record_frame(ms_since(start));
+    }
 }
 
 #include "ui.hpp"
@@ -316,36 +353,17 @@ void st_battle::handle_event(const SDL_Event& ev)
         {
             if (ev.type == SDL_KEYDOWN && ev.key.keysym.sym == state->session->keybinds.get_key(IA_JUMP))
             {
-                b_field.player().jump();
-                if (state->session->has_flashjump)
-                {
-                    b_field.player().use_skill(b_field, &s_flash_jump);
-                }
+                kit.jump(b_field);
             }
 
             if (ev.type == SDL_KEYDOWN && ev.key.keysym.sym == state->session->keybinds.get_key(IA_SKILL1))
             {
-                b_field.player().use_skill(b_field, &s_double_throw);
-
-                if (state->session->has_shadowpartner)
-                {
-                    s_shadow_timer = owner->create_timer(0.1);
-                    s_shadow_echo = &s_shadow_double_throw;
-                }
+                kit.throw_knives(b_field);
             }
 
             if (ev.type == SDL_KEYDOWN && ev.key.keysym.sym == state->session->keybinds.get_key(IA_SKILL2))
             {
-                if (state->session->has_avenger)
-                {
-                    b_field.player().use_skill(b_field, &s_avenger);
-
-                    if (state->session->has_shadowpartner)
-                    {
-                        s_shadow_timer = owner->create_timer(0.1);
-                        s_shadow_echo = &s_shadow_avenger;
-                    }
-                }
+                kit.throw_avenger(b_field);
             }
         }
     }
@@ -369,8 +387,6 @@ void st_battle::enter(gamestate* old)
     b_cam.tracking_rate = b_cam.TRACK_RATE_OPENING;
     // b_cam.center_on({ 1200, 400 });
 
-    b_field.clear();
-
     if (bf_name == "bf_dungeon")
     {
         bf_props = &BF_DUNGEON;
@@ -392,27 +408,29 @@ void st_battle::enter(gamestate* old)
     // probably rewrite this to use actual gl storage to prevent re-uploading
     cached_mesh& cmesh = get_mesh(bf_props->name);
     bf_render.set_mesh(cmesh.mesh);
-    b_field.bounds = cmesh.bounds;
-
-    b_field.spawn_character(BCI_PLAYER, {b_field.bounds.left + 16, 0});
 
-    int32_t spawn_offset = -16;
-    for (size_t i = 0; i < 8; ++i)
-    {
-        if (enc.enemies[i] == BCI_NULL)
-        {
-            continue;
-        }
-        b_field.spawn_character(enc.enemies[i], {b_field.bounds.right + spawn_offset, 0});
-        spawn_offset -= 32;
-    }
+    begin_battle();
+}
 
-    b_field.set_player_index(0);
+void st_battle::begin_battle()
+{
+    b_field.begin(enc, get_mesh(bf_props->name).bounds, get_rng(rng_battles).next_u64());
     b_field.player().life = state->session->stats.max_life();
     b_field.player().power = state->session->stats.power();
 
-    // tick twice to move objects into position... don't ask
-    b_field.init_positions();
+    kit = {};
+    kit.has_flashjump = state->session->has_flashjump;
+    kit.has_avenger = state->session->has_avenger;
+    kit.has_shadowpartner = state->session->has_shadowpartner;
+
+    if (stress)
+    {
+        sub = none;
+        b_field.player().power = 0;
+        kit.has_avenger = true;
+        kit.has_shadowpartner = true;
+    }
+
     b_cam.center_on(b_field.characters[b_field.characters.size() - 1].pos + glm::vec2(0, 8));
     b_cam.set_target(b_field.characters[b_field.characters.size() - 1].pos + glm::vec2(0, 8));
 }
@@ -430,3 +448,10 @@ void st_battle::set_encounter(encounter enc_)
 {
     enc = enc_;
 }
+
+void st_battle::start_stress_test()
+{
+    stress.emplace();
+    bf_name = "bf_dungeon";
+    enc = get_horde_encounter(stress->horde_size());
+}
@@ -1,16 +1,19 @@
 #pragma once
 
 #include <SDL.h>
+#include <optional>
 
+#include "audio.hpp"
 #include "battle/battle_camera.hpp"
 #include "battle/battle_field.hpp"
 #include "battle/encounters.hpp"
+#include "battle/player_kit.hpp"
 #include "battle_field_renderer.hpp"
 #include "battle_object_renderer.hpp"
+#include "battle_stress.hpp"
 #include "gamestate.hpp"
 #include "timer.hpp"
 
-struct audio_parameters;
 class game;
 
 struct cached_mesh
@@ -35,7 +38,12 @@ public:
     void set_battle_field_name(std::string bf_name);
     void set_encounter(encounter enc_);
 
+    // fight ever bigger hordes instead of the encounter set, logging what they cost
+    void start_stress_test();
+
 private:
+    void begin_battle();
+    void update_stress();
     void begin_transition();
     void render_fade();
     cached_mesh& get_mesh(const char* name);
@@ -49,7 +57,7 @@ private:
     battle_field_renderer bf_render;
     const battle_field_properties* bf_props;
 
-    std::shared_ptr<audio_parameters> current_music;
+    playback_id current_music = NO_PLAYBACK;
 
     enum substate
     {
@@ -71,9 +79,12 @@ private:
 
     battle_camera b_cam;
     battle_field b_field;
+    player_kit kit;
 
     std::string bf_name;
     encounter enc;
 
     battle_result b_result;
+
+    std::optional<battle_stress> stress;
 };
\ No newline at end of file
@@ -6,9 +6,11 @@
 
 #include "audio.hpp"
 #include "bmfont.hpp"
+#include "chunk_streamer.hpp"
 #include "foam_emitter.hpp"
 #include "game.hpp"
 #include "gamestate.hpp"
+#include "map_loader.hpp"
 #include "mathutil.hpp"
 #include "npc.hpp"
 #include "random_vec.hpp"
@@ -47,7 +49,7 @@ bool try_move_ent(world& wor, entity& e, direction f)
     direction enter_from;
 
     // ignore move if the entity is already moving
-    if (e.mstate != IDLE)
+    if (e.mstate() != IDLE)
     {
         return false;
     }
@@ -104,21 +106,21 @@ bool try_move_ent(world& wor, entity& e, direction f)
     // don't move to tiles that have a visible entity
     if (entity* other = wor.entity_at(target_x, target_y); other)
     {
-        if (!other->active)
+        if (!other->active())
         {
             // completely ignore inactive ents
         }
-        else if (other->type == npc || other->type == et_switch)
+        else if (other->get_type() == npc || other->get_type() == et_switch)
         {
             e.set_facing(f);
             return false;
         }
-        else if (other->type == door && !other->open)
+        else if (other->get_type() == door && !other->open)
         {
             e.set_facing(f);
             return false;
         }
-        else if (other->type == et_light && other->has_sprite())
+        else if (other->get_type() == et_light && other->has_sprite())
         {
             e.set_facing(f);
             return false;
@@ -129,8 +131,8 @@ bool try_move_ent(world& wor, entity& e, direction f)
     return true;
 }
 
-st_play::st_play(game* g, shared_state* s)
-    : owner{g}, state{s}
+st_play::st_play(game* g, shared_state* s, size_t map_cache_budget)
+    : owner{g}, state{s}, visited_maps{map_cache_budget}, script_host{std::make_unique<st_interact_context>(this)}
 {
 }
 
@@ -145,25 +147,34 @@ void st_play::init()
     t_lava_base = state->texman->get("assets/lava_base.png");
     t_lava_blend = state->texman->get("assets/lava_blend.png");
 
-    cam.set_bounds(0, 0, 100 * 16, 100 * 16);
     cam.set_width(INTERNAL_WIDTH);
     cam.set_height(INTERNAL_HEIGHT);
 
     wor = load_world("assets/maps/hub.bin");
     current_map_name = "hub";
+    cam.set_bounds(0, 0, wor.map.width * 16, wor.map.height * 16);
 
     entity* playerspawn = wor.find_entity("playerspawn");
     assert(playerspawn != nullptr);
 
     player_handle = wor.spawn_player(playerspawn->tile_x(), playerspawn->tile_y());
 
-    cam.center_on(wor.player().world_x + 8, wor.player().world_y + 8);
+    cam.center_on(wor.player().world_x() + 8, wor.player().world_y() + 8);
     prev_cam = cam;
 
     water_render = std::make_unique<water_renderer>();
     water_render->set_output_dimensions(INTERNAL_WIDTH, INTERNAL_HEIGHT); // TODO: get from game
 
     foam_em = std::make_unique<foam_emitter>(state->quad_render);
+
+    loader = std::make_unique<map_loader>(state->audio);
+    prefetch_neighbor_maps();
+
+    chase_flow.attach(wor.map);
+
+    streamer = std::make_unique<chunk_streamer>();
+    streamer->attach(&wor.map);
+    streamer->update(cam.get_view());
 }
 
 void st_play::handle_event(const SDL_Event& ev)
@@ -196,17 +207,17 @@ void st_play::handle_event(const SDL_Event& ev)
                 return;
             }
 
-            if (e->is_interactive() && e->active)
+            if (e->is_interactive() && e->active())
             {
                 auto script = get_npc_interact_script(e->interact_script);
                 e->set_facing(invert(player.face));
-                auto context = st_interact_context(this, e);
-                script(context);
+                start_script(script, e);
             }
         }
         else if (sub == message)
         {
             sub = none;
+            scripts.signal(se_message_closed);
         }
     }
 
@@ -255,15 +266,27 @@ void st_play::update()
     }
     else if (sub == map_exit_fadeout)
     {
+        // the destination was queued when the player stepped on the portal; if the worker hasn't
+        // finished by the end of the fade we simply stay faded out until it has
         if (me_timer.expired(state->frame_counter))
         {
-            current_music->done = true;
-            wor = std::move(me_new_world);
-            begin_map_intro();
+            state->audio->set_volume(current_music, 0);
+
+            if (acquire_next_world())
+            {
+                state->audio->stop(current_music);
+
+                entity* spawn = wor.find_entity(me_exit_name);
+                assert(spawn && "no exit with matching name");
+                wor.spawn_player(spawn->tile_x(), spawn->tile_y());
+
+                begin_map_intro();
+                prefetch_neighbor_maps();
+            }
         }
         else
         {
-            current_music->volume = 1.0f - static_cast<float>(me_timer.progress(state->frame_counter));
+            state->audio->set_volume(current_music, 1.0f - static_cast<float>(me_timer.progress(state->frame_counter)));
         }
     }
     else if (sub == battle_fadeout)
@@ -271,7 +294,7 @@ void st_play::update()
         if (b_fade_timer.expired(state->frame_counter))
         {
             transition_particles.clear();
-            current_music->paused = true;
+            state->audio->set_paused(current_music, true);
             assert(wor.has_encounters());
             assert(wor.battle_field_name.size());
             owner->get_battle_state().set_encounter(b_next_encounter);
@@ -280,7 +303,7 @@ void st_play::update()
         }
         else
         {
-            current_music->volume = 1.0f - static_cast<float>(b_fade_timer.progress(state->frame_counter));
+            state->audio->set_volume(current_music, 1.0f - static_cast<float>(b_fade_timer.progress(state->frame_counter)));
         }
         for (auto& p : transition_particles)
         {
@@ -292,12 +315,12 @@ void st_play::update()
     {
         if (b_fade_timer.expired(state->frame_counter))
         {
-            current_music->volume = 1.f;
+            state->audio->set_volume(current_music, 1.f);
             sub = none;
         }
         else
         {
-            current_music->volume = static_cast<float>(b_fade_timer.progress(state->frame_counter));
+            state->audio->set_volume(current_music, static_cast<float>(b_fade_timer.progress(state->frame_counter)));
         }
     }
     else if (sub == map_local_portal_fadeout)
@@ -317,15 +340,16 @@ void st_play::update()
         }
     }
 
-    if (sub == none)
+    if (sub == none && message_queue.empty())
     {
-        if (message_queue.size() > 0)
-        {
-            sub = message;
-            display_next_message();
-        }
+        scripts.signal(se_idle);
+    }
+    scripts.update(state->frame_counter);
 
-        process_scheduled_scripts();
+    if (sub == none && message_queue.size() > 0)
+    {
+        sub = message;
+        display_next_message();
     }
 
     if (sub == none)
@@ -346,45 +370,26 @@ void st_play::update()
         {
             try_move_player(down);
         }
+
+        move_chasers();
     }
 
+    // sites just off screen emit too so foam drifting into view doesn't pop in
     const float FOAM_EMIT_RATE = 0.15f;
-    for (uint32_t y = 0; y < wor.map.height; ++y)
-    {
-        for (uint32_t x = 0; x < wor.map.width; ++x)
-        {
-            const tile& t = wor.map.at(x, y);
-            if (t.is_water())
-            {
-                if (wor.map.valid(x - 1, y) && !wor.map.at(x - 1, y).is_water() && random::chance(FOAM_EMIT_RATE))
-                {
-                    foam_em->emit({x * 16, y * 16 + random::rand_int(0, 16)}, rand_vec2(-0.8f, 0.0f, -0.5f, 0.0f));
-                }
-                if (wor.map.valid(x + 1, y) && !wor.map.at(x + 1, y).is_water() && random::chance(FOAM_EMIT_RATE))
-                {
-                    foam_em->emit({16 + x * 16, y * 16 + random::rand_int(0, 16)}, rand_vec2(0.0f, 0.8f, -0.5f, 0.0f));
-                }
-                if (wor.map.valid(x, y - 1) && !wor.map.at(x, y - 1).is_water() && random::chance(FOAM_EMIT_RATE))
-                {
-                    foam_em->emit({x * 16 + random::rand_int(0, 16), y * 16}, rand_vec2(-0.2f, 0.2f, -0.8f, 0.0f));
-                }
-                if (wor.map.valid(x, y - 1) && wor.map.at(x, y - 1).is_waterfall() && random::chance(3 * FOAM_EMIT_RATE))
-                {
-                    foam_em->emit({x * 16 + random::rand_int(0, 16), y * 16}, rand_vec2(-0.2f, 0.2f, -0.8f, 0.0f), 6.f);
-                }
-                if (wor.map.valid(x, y + 1) && !wor.map.at(x, y + 1).is_water() && random::chance(FOAM_EMIT_RATE))
-                {
-                    foam_em->emit({x * 16 + random::rand_int(0, 16), 16 + y * 16}, rand_vec2(-0.2f, 0.2f, 0.0f, 0.8f));
-                }
-            }
-        }
-    }
+    rectangle foam_view = cam.get_view();
+    foam_view.x -= 16;
+    foam_view.y -= 16;
+    foam_view.w += 32;
+    foam_view.h += 32;
+    foam_em->emit_near(wor.foam, foam_view, FOAM_EMIT_RATE);
     foam_em->update();
 
-    wor.update();
+    wor.update(cam.get_view());
 
     prev_cam = cam;
-    cam.center_on(wor.player().world_x + 8, wor.player().world_y + 8);
+    cam.center_on(wor.player().world_x() + 8, wor.player().world_y() + 8);
+
+    streamer->update(cam.get_view());
 }
 
 void st_play::render(double a)
@@ -414,11 +419,15 @@ void st_play::render(double a)
     int max_tile_x = std::min(1 + lerp_cam.right() / 16, (int)wor.map.width);
     int min_tile_y = lerp_cam.top() / 16;
     int max_tile_y = std::min(1 + lerp_cam.bottom() / 16, (int)wor.map.height);
+
+    // layers may be compressed, so visible rows are decoded once instead of looking up every tile
+    row_tiles.resize(std::max(max_tile_x - min_tile_x, 0));
     for (int y = min_tile_y; y < max_tile_y; ++y)
     {
+        wor.map.base.decode_row(y, min_tile_x, row_tiles);
         for (int x = min_tile_x; x < max_tile_x; ++x)
         {
-            tile& t = wor.map.base.at(y * wor.map.width + x);
+            const tile& t = row_tiles[x - min_tile_x];
             if (t.invalid())
                 continue;
             uint32_t tid = t.id;
@@ -516,9 +525,10 @@ void st_play::render(double a)
     state->batch->begin();
     for (int y = min_tile_y; y < max_tile_y; ++y)
     {
+        wor.map.detail.decode_row(y, min_tile_x, row_tiles);
         for (int x = min_tile_x; x < max_tile_x; ++x)
         {
-            tile& t = wor.map.detail.at(y * wor.map.width + x);
+            const tile& t = row_tiles[x - min_tile_x];
             if (t.invalid())
                 continue;
             uint32_t tid = t.id;
@@ -531,35 +541,39 @@ void st_play::render(double a)
     }
     state->batch->end();
 
+    // only the hot entity arrays are walked here; lights are rare enough to look up their records
+    const entity_storage& es = *wor.ents;
     state->batch->begin();
-    for (entity& e : wor.ents)
+    for (size_t i = 0; i < es.size(); ++i)
     {
-        if (e.type == et_light)
+        if (es.flags[i] & ef_light)
         {
+            const light& l = es[i].light_state;
+
             // intentionally using frame_counter here to make the flickering more chaotic,
             // but still deterministic
             // also seeded by world position so different light sources aren't synchronized
-            const float angle = static_cast<float>(e.world_x + e.world_y + state->frame_counter);
-            float d_flicker = e.light_state.light_flicker_radius * cos(angle);
+            const float angle = static_cast<float>(es.world_x[i] + es.world_y[i] + state->frame_counter);
+            float d_flicker = l.light_flicker_radius * cos(angle);
 
-            light_cmds.push_back({static_cast<int>(e.world_x) - lerp_cam.left(), static_cast<int>(e.world_y) - lerp_cam.top(), d_flicker + e.light_state.light_radius});
+            light_cmds.push_back({static_cast<int>(es.world_x[i]) - lerp_cam.left(), static_cast<int>(es.world_y[i]) - lerp_cam.top(), d_flicker + l.light_radius});
         }
 
-        if (!e.active || !e.has_sprite())
+        if ((es.flags[i] & (ef_active | ef_sprite)) != (ef_active | ef_sprite))
         {
             continue;
         }
 
-        rectangle src = e.anim.current_rect();
+        rectangle src = es.anims[i].current_rect();
 
         int e_lerp_x = static_cast<int>(lerp(
-            static_cast<double>(e.prev_world_x),
-            static_cast<double>(e.world_x),
+            static_cast<double>(es.prev_world_x[i]),
+            static_cast<double>(es.world_x[i]),
             a));
 
         int e_lerp_y = static_cast<int>(lerp(
-            static_cast<double>(e.prev_world_y),
-            static_cast<double>(e.world_y),
+            static_cast<double>(es.prev_world_y[i]),
+            static_cast<double>(es.world_y[i]),
             a));
 
         int dx = e_lerp_x - lerp_cam.left();
@@ -568,7 +582,7 @@ void st_play::render(double a)
         rectangle dest{dx, dy, 16, 16};
         state->batch->draw_quad(t_atlas, src, dest);
 
-        if (&wor.player() == &e && wor.dark)
+        if (i == wor.player_index && wor.dark)
         {
             light_cmds.push_back({dx, dy, 1.f});
         }
@@ -580,9 +594,10 @@ void st_play::render(double a)
     state->batch->begin();
     for (int y = min_tile_y; y < max_tile_y; ++y)
     {
+        wor.map.fringe.decode_row(y, min_tile_x, row_tiles);
         for (int x = min_tile_x; x < max_tile_x; ++x)
         {
-            tile& t = wor.map.fringe.at(y * wor.map.width + x);
+            const tile& t = row_tiles[x - min_tile_x];
             if (t.invalid())
                 continue;
             uint32_t tid = t.id;
@@ -629,24 +644,11 @@ void st_play::render(double a)
     render_mlp_fade();
 }
 
-void st_play::process_scheduled_scripts()
+// runs until the script first waits on something; scripts.update picks it up from there
+void st_play::start_script(npc_interact_script script, entity* self)
 {
-    if (scheduled_scripts.size() == 0)
-    {
-        return;
-    }
-
-    // scripts can append more scripts to the collection, invalidating iterators; we have to take a different approach
-    for (size_t i = scheduled_scripts.size() - 1; i < scheduled_scripts.size(); --i)
-    {
-        if (scheduled_scripts[i].t.expired(state->frame_counter))
-        {
-            auto script = get_npc_interact_script(scheduled_scripts[i].script_id);
-            auto context = st_interact_context(this, nullptr);
-            script(context);
-            scheduled_scripts.erase(scheduled_scripts.begin() + i);
-        }
-    }
+    const uint32_t task = scripts.reserve();
+    scripts.start(task, script(npc_context{script_host.get(), self, task}));
 }
 
 void st_play::display_next_message()
@@ -655,18 +657,12 @@ void st_play::display_next_message()
     m_info = {t_atlas, t_dialogue_back};
     m_rect = measure_dialogue_box(m_info, m_text);
     message_queue.pop_front();
-
-    // UBERHACK
-    // need to implement a proper scripting system with coroutines so we can actually suspend/resume scripts
-    if (m_text == "#ragworm")
-    {
-        begin_battle_transition(get_final_boss_encounter());
-    }
 }
 
 void st_play::show_message(std::string_view m)
 {
     message_queue.push_back(std::string(m));
+    ++messages_queued;
 }
 
 void st_play::enter(gamestate* old)
@@ -683,7 +679,7 @@ void st_play::enter(gamestate* old)
         else
         {
             sub = battle_fadein;
-            current_music->paused = false;
+            state->audio->set_paused(current_music, false);
             b_fade_timer = owner->create_timer(1);
         }
     }
@@ -810,8 +806,8 @@ void st_play::begin_map_transition(const std::string& map_name, const std::strin
         // we don't want to transition immediately because the player is still in motion to the local portal
         // this is kind of weird and causes some timing issues (like this); ideally the engine would process
         // portal AFTER the player has stepped onto them
-        mlp_exit_x = exit->world_x;
-        mlp_exit_y = exit->world_y;
+        mlp_exit_x = exit->world_x();
+        mlp_exit_y = exit->world_y();
 
         sub = map_local_portal_fadeout;
         mlp_fade_timer = owner->create_timer(1);
@@ -819,19 +815,67 @@ void st_play::begin_map_transition(const std::string& map_name, const std::strin
         return;
     }
 
-    scheduled_scripts.clear();
-    current_map_name = map_name;
+    scripts.cancel_all();
+    me_map_name = map_name;
+    me_exit_name = exit_name;
 
-    const std::string filename = std::format("assets/maps/{}.bin", map_name);
-    me_new_world = load_world(filename.c_str());
-    entity* spawn = me_new_world.find_entity(exit_name);
-    assert(spawn && "no exit with matching name");
-    me_new_world.spawn_player(spawn->tile_x(), spawn->tile_y());
+    // usually already loaded or in flight thanks to prefetch_neighbor_maps; maps we've been to
+    // come back out of the cache instead
+    if (!visited_maps.contains(map_name))
+    {
+        loader->prefetch(map_name);
+    }
 
     me_timer = owner->create_timer(1);
     sub = map_exit_fadeout;
 }
 
+void st_play::prefetch_neighbor_maps()
+{
+    std::vector<std::string> neighbors;
+    for (const entity& e : *wor.ents)
+    {
+        if (e.get_type() == et_portal && e.portal_state.exit_map != current_map_name && !visited_maps.contains(e.portal_state.exit_map))
+        {
+            neighbors.push_back(e.portal_state.exit_map);
+        }
+    }
+
+    // anything more than one portal away is no longer interesting
+    loader->discard_except(neighbors);
+
+    for (const std::string& name : neighbors)
+    {
+        loader->prefetch(name);
+    }
+}
+
+// swaps in the world for me_map_name once it's available, parking the current world in the cache
+bool st_play::acquire_next_world()
+{
+    std::optional<world> next = visited_maps.take(me_map_name);
+    if (!next)
+    {
+        if (!loader->is_ready(me_map_name))
+        {
+            return false;
+        }
+        next = loader->take(me_map_name);
+    }
+
+    // the player is respawned at the exit portal on every visit, so don't keep a stale copy around
+    wor.despawn_player();
+    streamer->attach(nullptr);
+    visited_maps.put(current_map_name, std::move(wor));
+
+    wor = std::move(*next);
+    current_map_name = me_map_name;
+    cam.set_bounds(0, 0, wor.map.width * 16, wor.map.height * 16);
+    chase_flow.attach(wor.map);
+    streamer->attach(&wor.map);
+    return true;
+}
+
 void st_play::begin_map_intro()
 {
     mi_timer = owner->create_timer(3);
@@ -876,14 +920,15 @@ encounter st_play::pick_random_map_encounter()
 
 void st_play::emit_battle_transition_particles()
 {
+    rng_stream& rng = get_rng(rng_overworld);
     transition_particles.clear();
     for (int i = 0; i < 200; ++i)
     {
         battle_transition_particle& p = transition_particles.emplace_back();
         // p.pos = p.prev_pos = { INTERNAL_WIDTH + random::rand_real(0, INTERNAL_WIDTH), INTERNAL_HEIGHT + random::rand_real(0, INTERNAL_HEIGHT) };
         // p.vel = rand_vec2(-2, -1, -1, -0.3) * 16.f;
-        p.pos = p.prev_pos = {random::rand_real(0, INTERNAL_WIDTH), INTERNAL_HEIGHT + random::rand_real(0, INTERNAL_HEIGHT)};
-        p.vel = rand_vec2(-0.5, 0.5, -1, -0.5) * 16.f;
+        p.pos = p.prev_pos = {rng.rand_real(0, INTERNAL_WIDTH), INTERNAL_HEIGHT + rng.rand_real(0, INTERNAL_HEIGHT)};
+        p.vel = rand_vec2(rng, -0.5, 0.5, -1, -0.5) * 16.f;
     }
 }
 
@@ -902,7 +947,7 @@ void st_play::try_move_player(direction d)
         else
         {
             // yes this is absolutely evil but SHIP IT
-            if (encounters_enabled && wor.has_encounters() && steps >= 8 && random::chance(0.03f))
+            if (encounters_enabled && wor.has_encounters() && steps >= 8 && get_rng(rng_encounters).chance(0.03f))
             {
                 begin_battle_transition(pick_random_map_encounter());
                 return;
@@ -911,14 +956,34 @@ void st_play::try_move_player(direction d)
     }
 }
 
-void st_interact_context::say(const std::string& message)
+// idle chasers take the next step along the flow field, which is only built while someone is
+// following it. the player is tracked regardless so the field can be repaired as they move.
+void st_play::move_chasers()
 {
-    owner->show_message(message);
+    chase_flow.set_target(wor.player().tile_x(), wor.player().tile_y());
+
+    entity_storage& es = *wor.ents;
+    if (es.chasers.empty())
+    {
+        return;
+    }
+
+    for (uint32_t i : es.chasers)
+    {
+        direction d;
+        if ((es.flags[i] & ef_active) && i != wor.player_index && es.mstate[i] == IDLE && chase_flow.step_towards(es[i].tile_x(), es[i].tile_y(), d))
+        {
+            try_move_ent(wor, es[i], d);
+        }
+    }
+
+    chase_flow.update();
 }
 
-entity* st_interact_context::self() const
+task_wait st_interact_context::say(uint32_t task, const std::string& message)
 {
-    return ent;
+    owner->show_message(message);
+    return owner->scripts.until_event(task, st_play::se_message_closed, owner->messages_queued);
 }
 
 void st_interact_context::play_sound(const char* name)
@@ -927,11 +992,43 @@ void st_interact_context::play_sound(const char* name)
     owner->state->audio->play_sound(filename.c_str());
 }
 
+task_wait st_interact_context::wait(uint32_t task, double seconds)
+{
+    return owner->scripts.until_frame(task, owner->owner->create_timer(seconds).frame_end);
+}
+
+// steps always take a whole number of ticks, so there's no need to watch the entity
+task_wait st_interact_context::walk(uint32_t task, entity* e, direction d)
+{
+    if (!e || !try_move_ent(owner->wor, *e, d))
+    {
+        return owner->scripts.now(task, false);
+    }
+
+    const uint32_t ticks = (16 + e->move_speed() - 1) / e->move_speed();
+    return owner->scripts.until_frame(task, owner->state->frame_counter + ticks);
+}
+
+task_wait st_interact_context::until_idle(uint32_t task)
+{
+    return owner->scripts.until_event(task, st_play::se_idle, owner->scripts.event_count(st_play::se_idle) + 1);
+}
+
+void st_interact_context::begin_final_battle()
+{
+    owner->begin_battle_transition(get_final_boss_encounter());
+}
+
 entity* st_interact_context::get_entity(const char* name)
 {
     return owner->wor.find_entity(name);
 }
 
+void st_interact_context::set_chasing(entity* e, bool chase)
+{
+    e->set_chasing(chase);
+}
+
 void st_interact_context::set_flag(const char* name, int value)
 {
     owner->flags[name] = value;
@@ -949,14 +1046,6 @@ int st_interact_context::get_flag(const char* name)
     }
 }
 
-void st_interact_context::schedule(uint32_t id, double seconds_from_now)
-{
-    scheduled_script script;
-    script.script_id = id;
-    script.t = owner->owner->create_timer(seconds_from_now);
-    owner->scheduled_scripts.push_back(script);
-}
-
 session_state* st_interact_context::session()
 {
     return owner->state->session;
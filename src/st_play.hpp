@@ -5,28 +5,27 @@ class game;
 struct texture;
 class water_renderer;
 struct foam_emitter;
+class map_loader;
+class chunk_streamer;
+class st_interact_context;
 
 #include <SDL.h>
 #include <deque>
 #include <glm/vec2.hpp>
 #include <unordered_map>
 
+#include "audio.hpp"
 #include "battle/encounters.hpp"
 #include "camera.hpp"
 #include "dialoguebox.hpp"
+#include "flow_field.hpp"
 #include "gamestate.hpp"
 #include "npc.hpp"
+#include "npc_task.hpp"
 #include "timer.hpp"
+#include "world_cache.hpp"
 #include "world.hpp"
 
-struct audio_parameters;
-
-struct scheduled_script
-{
-    timer t;
-    uint32_t script_id;
-};
-
 struct battle_transition_particle
 {
     glm::vec2 pos, prev_pos, vel;
@@ -48,7 +47,8 @@ struct light_draw_cmd
 class st_play : public gamestate
 {
 public:
-    st_play(game* owner, shared_state* state);
+    // map_cache_budget is how many bytes of left maps are kept around for revisits
+    st_play(game* owner, shared_state* state, size_t map_cache_budget = world_cache::DEFAULT_BUDGET);
 
     void init() override;
     void update() override;
@@ -63,11 +63,14 @@ private:
     void render_map_fadeout();
     void begin_map_transition(const std::string& map_name, const std::string& exit_name);
     void begin_map_intro();
+    void prefetch_neighbor_maps();
+    bool acquire_next_world();
     void try_move_player(direction d);
+    void move_chasers();
     void begin_battle_transition(encounter enc);
     void render_battle_fade(double a);
     void display_next_message();
-    void process_scheduled_scripts();
+    void start_script(npc_interact_script script, entity* self);
     void emit_battle_transition_particles();
     void render_mlp_fade();
     encounter pick_random_map_encounter();
@@ -92,8 +95,13 @@ private:
 
     std::unique_ptr<water_renderer> water_render;
     std::unique_ptr<foam_emitter> foam_em;
+    std::unique_ptr<map_loader> loader;
+    std::unique_ptr<chunk_streamer> streamer;
+    world_cache visited_maps;
+    // leads chasing entities to the player
+    flow_field chase_flow;
 
-    std::shared_ptr<audio_parameters> current_music;
+    playback_id current_music = NO_PLAYBACK;
 
     size_t player_handle;
     int steps = 0;
@@ -124,6 +132,8 @@ private:
     substate sub = none;
 
     std::deque<std::string> message_queue;
+    // every message ever queued, so scripts know how many closes to wait for
+    uint64_t messages_queued = 0;
 
     dialogue_info m_info;
     std::string m_text;
@@ -132,7 +142,8 @@ private:
     timer mi_timer;
 
     timer me_timer;
-    world me_new_world;
+    std::string me_map_name;
+    std::string me_exit_name;
 
     timer mlp_fade_timer;
     uint32_t mlp_exit_x;
@@ -142,7 +153,17 @@ private:
     encounter b_next_encounter;
 
     std::unordered_map<std::string, int> flags;
-    std::vector<scheduled_script> scheduled_scripts;
+
+    // what scripts wait on besides frames
+    enum script_event : uint32_t
+    {
+        se_message_closed,
+        se_idle,
+    };
+
+    // running scripts, all of which belong to the current map visit
+    task_scheduler scripts;
+    std::unique_ptr<st_interact_context> script_host;
 
     std::vector<battle_transition_particle> transition_particles;
 
@@ -150,6 +171,7 @@ private:
 
     std::string current_map_name;
 
+    std::vector<tile> row_tiles;
     std::vector<water_draw_cmd> water_cmds;
     std::vector<water_draw_cmd> waterfall_cmds;
     std::vector<water_draw_cmd> lava_cmds;
@@ -158,24 +180,26 @@ private:
     friend class st_interact_context;
 };
 
-class st_interact_context : public npc_context
+class st_interact_context : public npc_host
 {
 public:
-    st_interact_context(st_play* o, entity* e)
-        : owner{o}, ent{e} {}
+    st_interact_context(st_play* o)
+        : owner{o} {}
 
 private:
     st_play* owner;
-    entity* ent;
 
-    // Inherited via npc_context
-    void say(const std::string& message) override;
-    entity* self() const override;
+    // Inherited via npc_host
+    task_wait say(uint32_t task, const std::string& message) override;
     void play_sound(const char* name) override;
-    void schedule(uint32_t id, double seconds_from_now) override;
+    task_wait wait(uint32_t task, double seconds) override;
+    task_wait walk(uint32_t task, entity* e, direction d) override;
+    task_wait until_idle(uint32_t task) override;
+    void begin_final_battle() override;
     entity* get_entity(const char* name) override;
+    void set_chasing(entity* e, bool chase) override;
     void set_flag(const char* name, int value) override;
     int get_flag(const char* name) override;
     session_state* session() override;
     void set_encounter_state(bool enabled) override;
-};
\ No newline at end of file
+};
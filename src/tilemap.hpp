@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <memory>
+#include <span>
 #include <string_view>
 #include <vector>
 
@@ -128,27 +133,379 @@ struct tile
     }
 };
 
+// tiles are read straight out of mapped map files, so the layout must stay a bare tile ID
+static_assert(sizeof(tile) == sizeof(uint32_t));
+
+enum class tile_encoding : uint32_t
+{
+    // one uint32_t tile ID per tile
+    raw32 = 0,
+
+    // per row, runs of identical 16 bit tile IDs
+    rle16 = 1,
+
+    // CHUNK_TILES square chunks, each rle16 encoded on its own, found through a chunk index
+    chunked16 = 2,
+};
+
+constexpr uint16_t TILE_RUN_NONE = UINT16_MAX;
+
+// a run of identical tiles within one row of an rle16 layer or chunk
+struct tile_run
+{
+    uint16_t id;     // TILE_RUN_NONE for "no tile"
+    uint16_t last_x; // inclusive
+
+    tile to_tile() const
+    {
+        return tile{id == TILE_RUN_NONE ? UINT32_MAX : id};
+    }
+};
+
+static_assert(sizeof(tile_run) == sizeof(uint32_t));
+
+constexpr uint32_t CHUNK_TILES = 32;
+constexpr uint32_t CHUNK_AREA = CHUNK_TILES * CHUNK_TILES;
+
+// Where a chunk's data lives, relative to the end of the chunk index. Chunk data is
+//   uint16_t row_starts[CHUNK_TILES + 1], padded to 4 bytes
+//   tile_run runs[row_starts[CHUNK_TILES]]
+// Chunks on the right and bottom edges are padded to full size with "no tile".
+struct tile_chunk_entry
+{
+    uint32_t offset;
+    uint32_t size;
+};
+
+constexpr uint32_t CHUNK_HEADER_SIZE = (CHUNK_TILES + 2) * sizeof(uint16_t);
+
+// decoded chunks of a chunked16 layer; managed by chunk_streamer
+struct chunk_residency
+{
+    std::vector<std::unique_ptr<tile[]>> chunks;
+    size_t resident = 0;
+};
+
+// A single layer of tiles, either stored raw or run-length encoded. The data is immutable and
+// lives in memory kept alive by `backing`: a memory-mapped map file when the layer is read in
+// place, or storage owned by the layer itself. Copies share the data.
+//
+// chunked16 layers additionally keep decoded copies of the chunks near the camera. Lookups in
+// chunks that aren't resident decode straight from the compressed data, so every tile can be
+// read at any time.
+class tile_layer
+{
+public:
+    tile_layer() = default;
+
+    tile_layer(std::vector<tile> tiles, uint32_t width_)
+        : width{width_}
+    {
+        auto storage = std::make_shared<owned_storage>();
+        storage->tiles = std::move(tiles);
+        raw = storage->tiles;
+        count = raw.size();
+        backing = std::move(storage);
+    }
+
+    tile_layer(std::span<const tile> tiles, uint32_t width_, std::shared_ptr<const void> backing_)
+        : width{width_}, raw{tiles}, count{tiles.size()}, backing{std::move(backing_)}
+    {
+    }
+
+    // row_starts has height + 1 entries; the runs of row y are [row_starts[y], row_starts[y + 1])
+    tile_layer(uint32_t width_, std::span<const uint32_t> row_starts_, std::span<const tile_run> runs_, std::shared_ptr<const void> backing_)
+        : enc{tile_encoding::rle16}, width{width_}, row_starts{row_starts_}, runs{runs_}, count{static_cast<size_t>(width_) * (row_starts_.size() - 1)}, backing{std::move(backing_)}
+    {
+        assert(row_starts.size() >= 1);
+    }
+
+    // chunk_index covers the map row-major in chunks; entries must lie within chunk_data
+    tile_layer(uint32_t width_, uint32_t height, std::span<const tile_chunk_entry> chunk_index_, std::span<const std::byte> chunk_data_, std::shared_ptr<const void> backing_)
+        : enc{tile_encoding::chunked16}, width{width_}, chunks_w{(width_ + CHUNK_TILES - 1) / CHUNK_TILES}, chunk_index{chunk_index_}, chunk_data{chunk_data_}, count{static_cast<size_t>(width_) * height}, backing{std::move(backing_)}
+    {
+        assert(chunk_index.size() == static_cast<size_t>(chunks_w) * ((height + CHUNK_TILES - 1) / CHUNK_TILES));
+        resident = std::make_shared<chunk_residency>();
+        resident->chunks.resize(chunk_index.size());
+    }
+
+    // rle16 encodes tiles if every ID fits in 16 bits, otherwise keeps them raw
+    static tile_layer encode(std::span<const tile> tiles, uint32_t width)
+    {
+        assert(width > 0 && width <= UINT16_MAX + 1 && tiles.size() % width == 0);
+
+        auto storage = std::make_shared<owned_storage>();
+        storage->row_starts.reserve(tiles.size() / width + 1);
+        storage->row_starts.push_back(0);
+
+        for (size_t row = 0; row < tiles.size(); row += width)
+        {
+            for (uint32_t x = 0; x < width; ++x)
+            {
+                uint32_t id = tiles[row + x].id;
+                if (id != UINT32_MAX && id >= TILE_RUN_NONE)
+                {
+                    return tile_layer{std::vector<tile>(tiles.begin(), tiles.end()), width};
+                }
+
+                uint16_t id16 = id == UINT32_MAX ? TILE_RUN_NONE : static_cast<uint16_t>(id);
+                if (x > 0 && storage->runs.back().id == id16)
+                {
+                    storage->runs.back().last_x = static_cast<uint16_t>(x);
+                }
+                else
+                {
+                    storage->runs.push_back({id16, static_cast<uint16_t>(x)});
+                }
+            }
+            storage->row_starts.push_back(static_cast<uint32_t>(storage->runs.size()));
+        }
+
+        tile_layer layer{width, storage->row_starts, storage->runs, nullptr};
+        layer.backing = std::move(storage);
+        return layer;
+    }
+
+    tile operator[](size_t i) const
+    {
+        switch (enc)
+        {
+        case tile_encoding::raw32:
+            return raw[i];
+        case tile_encoding::rle16:
+            return run_at(static_cast<uint32_t>(i / width), static_cast<uint32_t>(i % width))->to_tile();
+        case tile_encoding::chunked16:
+        default:
+            return chunk_tile_at(static_cast<uint32_t>(i % width), static_cast<uint32_t>(i / width));
+        }
+    }
+
+    tile at(size_t i) const
+    {
+        assert(i < count);
+        return (*this)[i];
+    }
+
+    // decodes out.size() tiles of row y starting at column x
+    void decode_row(uint32_t y, uint32_t x, std::span<tile> out) const
+    {
+        assert(x + out.size() <= width);
+
+        if (enc == tile_encoding::raw32)
+        {
+            std::copy_n(raw.begin() + static_cast<size_t>(y) * width + x, out.size(), out.begin());
+        }
+        else if (enc == tile_encoding::rle16)
+        {
+            const tile_run* r = run_at(y, x);
+            for (size_t i = 0; i < out.size(); ++i)
+            {
+                if (x + i > r->last_x)
+                {
+                    ++r;
+                }
+                out[i] = r->to_tile();
+            }
+        }
+        else
+        {
+            // one chunk at a time, from the decoded copy if there is one
+            size_t done = 0;
+            while (done < out.size())
+            {
+                uint32_t cx = static_cast<uint32_t>(x + done);
+                uint32_t local_x = cx % CHUNK_TILES;
+                uint32_t n = std::min<uint32_t>(CHUNK_TILES - local_x, static_cast<uint32_t>(out.size() - done));
+                uint32_t c = (y / CHUNK_TILES) * chunks_w + cx / CHUNK_TILES;
+                std::span<tile> part = out.subspan(done, n);
+
+                if (const tile* decoded = resident->chunks[c].get())
+                {
+                    std::copy_n(decoded + (y % CHUNK_TILES) * CHUNK_TILES + local_x, n, part.begin());
+                }
+                else
+                {
+                    decode_chunk_row(c, y % CHUNK_TILES, local_x, part);
+                }
+                done += n;
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    tile_encoding encoding() const
+    {
+        return enc;
+    }
+
+    // bytes kept alive by this layer, whether owned or viewed, including decoded chunks
+    size_t memory_usage() const
+    {
+        size_t bytes = raw.size_bytes() + row_starts.size_bytes() + runs.size_bytes() + chunk_index.size_bytes() + chunk_data.size_bytes();
+        if (resident)
+        {
+            bytes += resident->resident * CHUNK_AREA * sizeof(tile);
+        }
+        return bytes;
+    }
+
+    bool is_chunked() const
+    {
+        return enc == tile_encoding::chunked16;
+    }
+
+    size_t chunk_count() const
+    {
+        return chunk_index.size();
+    }
+
+    // decodes a whole chunk from the compressed data; only reads immutable data, so it's safe to
+    // call from any thread
+    void decode_chunk(uint32_t c, std::span<tile> out) const
+    {
+        assert(out.size() == CHUNK_AREA);
+        for (uint32_t y = 0; y < CHUNK_TILES; ++y)
+        {
+            decode_chunk_row(c, y, 0, out.subspan(y * CHUNK_TILES, CHUNK_TILES));
+        }
+    }
+
+    // the decoded chunk table is shared by copies of the layer; main thread only
+    void install_chunk(uint32_t c, std::unique_ptr<tile[]> tiles)
+    {
+        assert(is_chunked() && c < chunk_index.size());
+        if (!resident->chunks[c])
+        {
+            ++resident->resident;
+        }
+        resident->chunks[c] = std::move(tiles);
+    }
+
+    void evict_chunk(uint32_t c)
+    {
+        assert(is_chunked() && c < chunk_index.size());
+        if (resident->chunks[c])
+        {
+            --resident->resident;
+            resident->chunks[c].reset();
+        }
+    }
+
+    bool chunk_resident(uint32_t c) const
+    {
+        return is_chunked() && resident->chunks[c] != nullptr;
+    }
+
+private:
+    struct owned_storage
+    {
+        std::vector<tile> tiles;
+        std::vector<uint32_t> row_starts;
+        std::vector<tile_run> runs;
+    };
+
+    const tile_run* run_at(uint32_t y, uint32_t x) const
+    {
+        assert(y + 1 < row_starts.size() && x < width);
+        const tile_run* first = runs.data() + row_starts[y];
+        const tile_run* last = runs.data() + row_starts[y + 1];
+        return std::lower_bound(first, last, x, [](const tile_run& r, uint32_t x) {
+            return r.last_x < x;
+        });
+    }
+
+    // runs of one row of a chunk. chunk data is only checked against the index when the map is
+    // loaded, so malformed rows come back empty instead of being trusted.
+    std::span<const tile_run> chunk_row_runs(uint32_t c, uint32_t local_y) const
+    {
+        const tile_chunk_entry& entry = chunk_index[c];
+        const std::byte* data = chunk_data.data() + entry.offset;
+        const uint16_t* chunk_row_starts = reinterpret_cast<const uint16_t*>(data);
+        const tile_run* chunk_runs = reinterpret_cast<const tile_run*>(data + CHUNK_HEADER_SIZE);
+        const size_t run_count = (entry.size - CHUNK_HEADER_SIZE) / sizeof(tile_run);
+
+        uint16_t first = chunk_row_starts[local_y];
+        uint16_t last = chunk_row_starts[local_y + 1];
+        if (first >= last || last > run_count)
+        {
+            return {};
+        }
+        return {chunk_runs + first, chunk_runs + last};
+    }
+
+    void decode_chunk_row(uint32_t c, uint32_t local_y, uint32_t local_x, std::span<tile> out) const
+    {
+        std::span<const tile_run> row = chunk_row_runs(c, local_y);
+        auto r = std::lower_bound(row.begin(), row.end(), local_x, [](const tile_run& r, uint32_t x) {
+            return r.last_x < x;
+        });
+
+        for (size_t i = 0; i < out.size(); ++i)
+        {
+            while (r != row.end() && local_x + i > r->last_x)
+            {
+                ++r;
+            }
+            out[i] = r != row.end() ? r->to_tile() : tile{};
+        }
+    }
+
+    tile chunk_tile_at(uint32_t x, uint32_t y) const
+    {
+        uint32_t c = (y / CHUNK_TILES) * chunks_w + x / CHUNK_TILES;
+        if (const tile* decoded = resident->chunks[c].get())
+        {
+            return decoded[(y % CHUNK_TILES) * CHUNK_TILES + x % CHUNK_TILES];
+        }
+
+        tile t;
+        decode_chunk_row(c, y % CHUNK_TILES, x % CHUNK_TILES, {&t, 1});
+        return t;
+    }
+
+    tile_encoding enc = tile_encoding::raw32;
+    uint32_t width = 0;
+    uint32_t chunks_w = 0;
+    std::span<const tile> raw;
+    std::span<const uint32_t> row_starts;
+    std::span<const tile_run> runs;
+    std::span<const tile_chunk_entry> chunk_index;
+    std::span<const std::byte> chunk_data;
+    std::shared_ptr<chunk_residency> resident;
+    size_t count = 0;
+    std::shared_ptr<const void> backing;
+};
+
 struct tilemap
 {
     uint32_t width, height;
-    std::vector<tile> base;
-    std::vector<tile> detail;
-    std::vector<tile> fringe;
+    tile_layer base;
+    tile_layer detail;
+    tile_layer fringe;
     // std::vector<float> bright_map;
 
-    const tile& at(uint32_t x, uint32_t y) const
+    tile at(uint32_t x, uint32_t y) const
     {
         return base[y * width + x];
     }
 
+    size_t memory_usage() const
+    {
+        return base.memory_usage() + detail.memory_usage() + fringe.memory_usage();
+    }
+
     bool in_bounds(uint32_t x, uint32_t y) const
     {
-        return x >= 0 && y >= 0 && x < width && y < height;
+        return x < width && y < height;
     }
 
     bool valid(uint32_t x, uint32_t y) const
     {
-        bool in_bounds = x >= 0 && y >= 0 && x < width && y < height;
+        bool in_bounds = x < width && y < height;
         if (!in_bounds)
         {
             return false;
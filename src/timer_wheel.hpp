@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+struct timer_handle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+// Schedules payloads to fire on a given frame. Timers hang off one of SLOT_COUNT slots picked by
+// their due frame, so scheduling and cancelling are O(1) and advancing a frame only looks at that
+// frame's slot; a timer further out than SLOT_COUNT frames just gets looked at once per lap.
+//
+// Every timer carries a scope, and a whole scope can be cancelled at once. Firing may schedule or
+// cancel other timers: anything scheduled while advancing is due no earlier than the next frame.
+template <typename T>
+class timer_wheel
+{
+public:
+    static constexpr uint32_t SLOT_COUNT = 256;
+
+    timer_wheel()
+    {
+        slots.fill(NO_TIMER);
+    }
+
+    // anything due on or before the current frame fires on the next advance
+    timer_handle schedule(uint32_t due_frame, T payload, uint32_t scope = 0)
+    {
+        due_frame = std::max(due_frame, now + 1);
+
+        uint32_t index;
+        if (free_list != NO_TIMER)
+        {
+            index = free_list;
+            free_list = pool[index].next;
+        }
+        else
+        {
+            index = static_cast<uint32_t>(pool.size());
+            pool.emplace_back();
+        }
+
+        timer_entry& e = pool[index];
+        e.due_frame = due_frame;
+        e.scope = scope;
+        e.live = true;
+        e.payload = std::move(payload);
+        link(index);
+        ++pending;
+        return {index, e.generation};
+    }
+
+    // false if the timer already fired or was cancelled
+    bool cancel(timer_handle h)
+    {
+        if (h.index >= pool.size() || pool[h.index].generation != h.generation || !pool[h.index].live)
+        {
+            return false;
+        }
+
+        // unlinked when its slot next comes around
+        pool[h.index].live = false;
+        --pending;
+        return true;
+    }
+
+    void cancel_scope(uint32_t scope)
+    {
+        for (timer_entry& e : pool)
+        {
+            if (e.live && e.scope == scope)
+            {
+                e.live = false;
+                --pending;
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return pending;
+    }
+
+    // fires everything due up to and including frame, in no particular order within one call
+    template <typename F>
+    void advance(uint32_t frame, F&& fire)
+    {
+        if (frame <= now)
+        {
+            return;
+        }
+
+        // catching up over more than a lap visits every slot once
+        const uint32_t first = now + 1;
+        const uint32_t count = std::min(frame - now, SLOT_COUNT);
+        now = frame;
+
+        for (uint32_t f = first; f < first + count; ++f)
+        {
+            uint32_t i = slots[f % SLOT_COUNT];
+            slots[f % SLOT_COUNT] = NO_TIMER;
+
+            while (i != NO_TIMER)
+            {
+                const uint32_t next = pool[i].next;
+                if (!pool[i].live)
+                {
+                    release(i);
+                }
+                else if (pool[i].due_frame <= frame)
+                {
+                    // fire may schedule, which can grow the pool under us
+                    T payload = std::move(pool[i].payload);
+                    pool[i].live = false;
+                    --pending;
+                    release(i);
+                    fire(payload);
+                }
+                else
+                {
+                    link(i);
+                }
+                i = next;
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t NO_TIMER = UINT32_MAX;
+
+    struct timer_entry
+    {
+        uint32_t due_frame = 0;
+        uint32_t scope = 0;
+        uint32_t generation = 0;
+        uint32_t next = NO_TIMER;
+        bool live = false;
+        T payload{};
+    };
+
+    void link(uint32_t index)
+    {
+        uint32_t& head = slots[pool[index].due_frame % SLOT_COUNT];
+        pool[index].next = head;
+        head = index;
+    }
+
+    void release(uint32_t index)
+    {
+        ++pool[index].generation;
+        pool[index].next = free_list;
+        free_list = index;
+    }
+
+    std::vector<timer_entry> pool;
+    std::array<uint32_t, SLOT_COUNT> slots;
+    uint32_t free_list = NO_TIMER;
+    uint32_t now = 0;
+    size_t pending = 0;
+};
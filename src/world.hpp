@@ -7,6 +7,7 @@
 
 #include "animation.hpp"
 #include "animation_data.hpp"
+#include "foam_sites.hpp"
 #include "tilemap.hpp"
 
 struct portal
@@ -27,7 +28,7 @@ struct e_switch
     bool on = false;
 };
 
-enum move_state
+enum move_state : uint8_t
 {
     IDLE,
     MOVE_LEFT,
@@ -47,31 +48,176 @@ enum entity_type
     et_switch,
 };
 
+// kept alongside the hot entity data so update and rendering can skip entities without looking
+// at their cold records
+enum entity_flags : uint8_t
+{
+    ef_active = 1 << 0,
+    ef_sprite = 1 << 1,
+    ef_light = 1 << 2,
+    ef_clocked = 1 << 3, // sprite follows a global animation clock, nothing to update
+    ef_chaser = 1 << 4,  // walks towards the player on its own
+    ef_awake = 1 << 5,   // in entity_storage::awake
+};
+
+// how last update's entities were spread out
+struct activity_stats
+{
+    size_t active = 0;   // updated at full rate
+    size_t sleeping = 0; // not updated at all
+    size_t lod = 0;      // out of range, animated at a reduced rate
+};
+
+struct entity;
+
+// Entity storage split by access pattern. Everything world::update and rendering need every
+// frame lives in parallel arrays indexed by entity index; names, script IDs, portal targets and
+// the rest stay in the cold entity records. Records point back at their storage, which is why
+// worlds keep it on the heap.
+//
+// Only awake entities are updated. An entity falls asleep once it stands still with nothing left
+// to animate, and anything that moves it or changes its animation wakes it up again. Awake ones
+// outside the area passed to update() still move every tick, but only animate every LOD_INTERVAL
+// ticks, catching up in one go.
+class entity_storage
+{
+public:
+    static constexpr uint32_t LOD_INTERVAL = 4;
+
+    entity_storage() = default;
+    entity_storage(const entity_storage&) = delete;
+    entity_storage& operator=(const entity_storage&) = delete;
+
+    // hot
+    std::vector<uint32_t> world_x, world_y;
+    std::vector<uint32_t> prev_world_x, prev_world_y;
+    std::vector<move_state> mstate;
+    std::vector<uint8_t> move_speed;
+    std::vector<uint8_t> flags;
+    std::vector<animator> anims;
+
+    // cold
+    std::vector<entity> records;
+
+    // indices of the entities update() looks at, in no particular order
+    std::vector<uint32_t> awake;
+    // indices of the entities with ef_chaser, in no particular order
+    std::vector<uint32_t> chasers;
+    activity_stats activity;
+
+    entity& add();
+    void remove(size_t index);
+    void reserve(size_t count);
+    void wake(size_t index);
+    void set_chasing(size_t index, bool chase);
+    void update(const rectangle& near_area);
+
+    size_t size() const
+    {
+        return records.size();
+    }
+
+    entity& operator[](size_t index)
+    {
+        return records[index];
+    }
+
+    const entity& operator[](size_t index) const
+    {
+        return records[index];
+    }
+
+    auto begin()
+    {
+        return records.begin();
+    }
+
+    auto end()
+    {
+        return records.end();
+    }
+
+    auto begin() const
+    {
+        return records.begin();
+    }
+
+    auto end() const
+    {
+        return records.end();
+    }
+
+    size_t memory_usage() const;
+
+private:
+    bool can_sleep(size_t index) const;
+
+    uint32_t tick = 0;
+};
+
 struct entity
 {
     static constexpr uint32_t INVALID_SCRIPT = UINT32_MAX;
     static constexpr uint32_t INVALID_SPRITE = UINT32_MAX;
 
     std::string name;
-    move_state mstate = IDLE;
     direction face = down;
-    uint32_t world_x = 0, world_y = 0;
-    uint32_t prev_world_x = 0, prev_world_y = 0;
-    uint32_t move_speed = 4;
     uint32_t interact_script = INVALID_SCRIPT;
     uint32_t sprite_id = INVALID_SPRITE;
-    entity_type type = none;
     bool open = false;
     portal portal_state;
     light light_state;
     e_switch switch_state;
-    bool active = true;
 
-    const animation_set* aset;
-    animator anim;
+    const animation_set* aset = nullptr;
+
+    entity_storage* store = nullptr;
+    uint32_t index = 0;
 
-    entity()
+    uint32_t world_x() const
     {
+        return store->world_x[index];
+    }
+
+    uint32_t world_y() const
+    {
+        return store->world_y[index];
+    }
+
+    uint32_t prev_world_x() const
+    {
+        return store->prev_world_x[index];
+    }
+
+    uint32_t prev_world_y() const
+    {
+        return store->prev_world_y[index];
+    }
+
+    move_state mstate() const
+    {
+        return store->mstate[index];
+    }
+
+    // pixels per tick
+    uint8_t move_speed() const
+    {
+        return store->move_speed[index];
+    }
+
+    animator& anim()
+    {
+        return store->anims[index];
+    }
+
+    const animator& anim() const
+    {
+        return store->anims[index];
+    }
+
+    bool active() const
+    {
+        return store->flags[index] & ef_active;
     }
 
     bool is_interactive() const
@@ -79,16 +225,35 @@ struct entity
         return interact_script != INVALID_SCRIPT;
     }
 
+    bool chasing() const
+    {
+        return store->flags[index] & ef_chaser;
+    }
+
     bool has_sprite() const
     {
         return sprite_id != INVALID_SPRITE;
     }
 
+    entity_type get_type() const
+    {
+        return type;
+    }
+
+    void set_type(entity_type t)
+    {
+        type = t;
+        set_flag(ef_light, t == et_light);
+    }
+
     void set_sprite_id(uint32_t id)
     {
         sprite_id = id;
         aset = get_animation_set(id);
-        anim.set_animation_set(aset);
+        anim().set_animation_set(aset);
+        set_flag(ef_sprite, true);
+        wake();
+        set_flag(ef_clocked, aset->clock != animation_set::NO_CLOCK);
         if (type == npc)
         {
             set_animation_from_facing();
@@ -108,86 +273,42 @@ struct entity
     {
         assert(new_world_x % 16 == 0);
         assert(new_world_y % 16 == 0);
-        world_x = new_world_x;
-        world_y = new_world_y;
-        prev_world_x = world_x;
-        prev_world_y = world_y;
+        store->world_x[index] = new_world_x;
+        store->world_y[index] = new_world_y;
+        store->prev_world_x[index] = new_world_x;
+        store->prev_world_y[index] = new_world_y;
     }
 
     uint32_t tile_x() const
     {
-        return world_x / 16;
+        return world_x() / 16;
     }
 
     uint32_t tile_y() const
     {
-        return world_y / 16;
-    }
-
-    void update()
-    {
-        prev_world_x = world_x;
-        prev_world_y = world_y;
-
-        if (mstate == MOVE_LEFT)
-        {
-            world_x -= move_speed;
-        }
-        if (mstate == MOVE_RIGHT)
-        {
-            world_x += move_speed;
-        }
-        if (mstate == MOVE_UP)
-        {
-            world_y -= move_speed;
-        }
-        if (mstate == MOVE_DOWN)
-        {
-            world_y += move_speed;
-        }
-
-        switch (mstate)
-        {
-        case MOVE_LEFT:
-        case MOVE_RIGHT:
-            if (world_x % 16 == 0)
-            {
-                mstate = IDLE;
-            }
-            break;
-        case MOVE_UP:
-        case MOVE_DOWN:
-            if (world_y % 16 == 0)
-            {
-                mstate = IDLE;
-            }
-            break;
-        default:
-            break;
-        }
-
-        if (has_sprite())
-            anim.update();
+        return world_y() / 16;
     }
 
     void begin_move(direction f)
     {
-        if (mstate != IDLE)
+        if (mstate() != IDLE)
             return;
 
+        wake();
+
         switch (f)
         {
         case down:
-            mstate = MOVE_DOWN;
+            store->mstate[index] = MOVE_DOWN;
             break;
         case left:
-            mstate = MOVE_LEFT;
+            store->mstate[index] = MOVE_LEFT;
             break;
         case right:
-            mstate = MOVE_RIGHT;
+            store->mstate[index] = MOVE_RIGHT;
             break;
         case up:
-            mstate = MOVE_UP;
+            store->mstate[index] = MOVE_UP;
             break;
         }
 
@@ -212,34 +333,36 @@ struct entity
 
     void set_animation_from_facing()
     {
+        wake();
         switch (face)
         {
         case down:
-            anim.set_animation("down");
+            anim().set_animation(anim_down);
             break;
         case left:
-            anim.set_animation("left");
+            anim().set_animation(anim_left);
             break;
         case right:
-            anim.set_animation("right");
+            anim().set_animation(anim_right);
             break;
         case up:
-            anim.set_animation("up");
+            anim().set_animation(anim_up);
             break;
         }
     }
 
     void set_animation_from_doorstate()
     {
-        const char* new_name = open ? "open" : "closed";
-        anim.set_animation(new_name);
+        wake();
+        anim().set_animation(open ? anim_open : anim_closed);
     }
 
     void set_doorstate(bool is_open)
     {
         if (!open && is_open)
         {
-            anim.set_animation("closed-open");
+            wake();
+            anim().set_animation(anim_closed_open);
         }
         open = is_open;
     }
@@ -260,32 +383,261 @@ struct entity
         bool now_on = is_on;
 
         switch_state.on = now_on;
+        wake();
 
         if (was_on && !now_on)
         {
-            anim.set_animation("on-off");
+            anim().set_animation(anim_on_off);
         }
         else if (!was_on && now_on)
         {
-            anim.set_animation("off-on");
+            anim().set_animation(anim_off_on);
         }
         else if (now_on)
         {
             // these last two branches look weird but they're here for switch initialization
-            anim.set_animation("on");
+            anim().set_animation(anim_on);
         }
         else if (!now_on)
         {
-            anim.set_animation("off");
+            anim().set_animation(anim_off);
         }
     }
 
     void set_active(bool is_active)
     {
-        active = is_active;
+        set_flag(ef_active, is_active);
+        wake();
+    }
+
+    void set_chasing(bool chase)
+    {
+        store->set_chasing(index, chase);
+    }
+
+    // for anything that changes the entity behind its setters' backs
+    void wake()
+    {
+        store->wake(index);
+    }
+
+private:
+    // only set_type changes it, which keeps ef_light in step
+    entity_type type = none;
+
+    void set_flag(entity_flags f, bool on)
+    {
+        if (on)
+            store->flags[index] |= f;
+        else
+            store->flags[index] &= ~f;
     }
 };
 
+inline entity& entity_storage::add()
+{
+    world_x.push_back(0);
+    world_y.push_back(0);
+    prev_world_x.push_back(0);
+    prev_world_y.push_back(0);
+    mstate.push_back(IDLE);
+    move_speed.push_back(4);
+    flags.push_back(ef_active | ef_awake);
+    anims.emplace_back();
+
+    entity& e = records.emplace_back();
+    e.store = this;
+    e.index = static_cast<uint32_t>(records.size() - 1);
+    awake.push_back(e.index);
+    return e;
+}
+
+inline void entity_storage::remove(size_t i)
+{
+    assert(i < records.size());
+    world_x.erase(world_x.begin() + i);
+    world_y.erase(world_y.begin() + i);
+    prev_world_x.erase(prev_world_x.begin() + i);
+    prev_world_y.erase(prev_world_y.begin() + i);
+    mstate.erase(mstate.begin() + i);
+    move_speed.erase(move_speed.begin() + i);
+    flags.erase(flags.begin() + i);
+    anims.erase(anims.begin() + i);
+    records.erase(records.begin() + i);
+
+    for (size_t j = i; j < records.size(); ++j)
+    {
+        records[j].index = static_cast<uint32_t>(j);
+    }
+
+    // indices shifted; everyone gets another look and the idle ones drop off again
+    awake.clear();
+    chasers.clear();
+    for (size_t j = 0; j < records.size(); ++j)
+    {
+        flags[j] |= ef_awake;
+        awake.push_back(static_cast<uint32_t>(j));
+        if (flags[j] & ef_chaser)
+        {
+            chasers.push_back(static_cast<uint32_t>(j));
+        }
+    }
+}
+
+inline void entity_storage::reserve(size_t count)
+{
+    world_x.reserve(count);
+    world_y.reserve(count);
+    prev_world_x.reserve(count);
+    prev_world_y.reserve(count);
+    mstate.reserve(count);
+    move_speed.reserve(count);
+    flags.reserve(count);
+    anims.reserve(count);
+    records.reserve(count);
+    awake.reserve(count);
+}
+
+inline void entity_storage::wake(size_t i)
+{
+    if (!(flags[i] & ef_awake))
+    {
+        flags[i] |= ef_awake;
+        awake.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+inline void entity_storage::set_chasing(size_t i, bool chase)
+{
+    if (chase && !(flags[i] & ef_chaser))
+    {
+        flags[i] |= ef_chaser;
+        chasers.push_back(static_cast<uint32_t>(i));
+    }
+    else if (!chase && (flags[i] & ef_chaser))
+    {
+        flags[i] &= ~ef_chaser;
+        std::erase(chasers, static_cast<uint32_t>(i));
+    }
+}
+
+// standing still (and done interpolating) with a frozen or hidden sprite
+inline bool entity_storage::can_sleep(size_t i) const
+{
+    if (mstate[i] != IDLE || prev_world_x[i] != world_x[i] || prev_world_y[i] != world_y[i])
+    {
+        return false;
+    }
+    if ((flags[i] & (ef_active | ef_sprite)) != (ef_active | ef_sprite) || (flags[i] & ef_clocked))
+    {
+        return true;
+    }
+    return anims[i].is_static();
+}
+
+// only touches the hot arrays
+inline void entity_storage::update(const rectangle& near_area)
+{
+    const uint32_t t = ++tick;
+    size_t near_count = 0;
+
+    // anything overlapping near_area is near
+    const int near_left = near_area.left() - 16;
+    const int near_right = near_area.right();
+    const int near_top = near_area.top() - 16;
+    const int near_bottom = near_area.bottom();
+
+    // compacted in place rather than swap-removed, to keep walking the arrays mostly in order
+    size_t kept = 0;
+    for (size_t j = 0; j < awake.size(); ++j)
+    {
+        const uint32_t i = awake[j];
+
+        prev_world_x[i] = world_x[i];
+        prev_world_y[i] = world_y[i];
+
+        switch (mstate[i])
+        {
+        case MOVE_LEFT:
+            world_x[i] -= move_speed[i];
+            break;
+        case MOVE_RIGHT:
+            world_x[i] += move_speed[i];
+            break;
+        case MOVE_UP:
+            world_y[i] -= move_speed[i];
+            break;
+        case MOVE_DOWN:
+            world_y[i] += move_speed[i];
+            break;
+        default:
+            break;
+        }
+
+        switch (mstate[i])
+        {
+        case MOVE_LEFT:
+        case MOVE_RIGHT:
+            if (world_x[i] % 16 == 0)
+            {
+                mstate[i] = IDLE;
+            }
+            break;
+        case MOVE_UP:
+        case MOVE_DOWN:
+            if (world_y[i] % 16 == 0)
+            {
+                mstate[i] = IDLE;
+            }
+            break;
+        default:
+            break;
+        }
+
+        const int x = static_cast<int>(world_x[i]);
+        const int y = static_cast<int>(world_y[i]);
+        const bool near = x > near_left && x < near_right && y > near_top && y < near_bottom;
+
+        if ((flags[i] & (ef_sprite | ef_clocked)) == ef_sprite)
+        {
+            // staggered so the far ones don't all land on the same tick
+            if (near)
+                anims[i].update();
+            else if ((t + i) % LOD_INTERVAL == 0)
+                anims[i].update(LOD_INTERVAL);
+        }
+
+        if (can_sleep(i))
+        {
+            flags[i] &= ~ef_awake;
+            continue;
+        }
+
+        near_count += near;
+        awake[kept++] = i;
+    }
+    awake.resize(kept);
+
+    activity.active = near_count;
+    activity.lod = kept - near_count;
+    activity.sleeping = records.size() - kept;
+}
+
+inline size_t entity_storage::memory_usage() const
+{
+    size_t bytes = sizeof(entity_storage);
+    bytes += (world_x.capacity() + world_y.capacity() + prev_world_x.capacity() + prev_world_y.capacity()) * sizeof(uint32_t);
+    bytes += mstate.capacity() * sizeof(move_state) + move_speed.capacity() + flags.capacity();
+    bytes += anims.capacity() * sizeof(animator) + records.capacity() * sizeof(entity);
+    bytes += (awake.capacity() + chasers.capacity()) * sizeof(uint32_t);
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        const entity& e = records[i];
+        bytes += e.name.capacity() + e.portal_state.exit_map.capacity() + e.portal_state.exit_name.capacity();
+    }
+    return bytes;
+}
+
 inline uint32_t tile_to_world(uint32_t x)
 {
     return x * 16;
@@ -300,9 +652,10 @@ struct world
 {
     static constexpr size_t INVALID_PLAYER_INDEX = SIZE_MAX;
     static constexpr uint32_t INVALID_ENCOUNTER = UINT32_MAX;
+    static constexpr uint32_t DEFAULT_LOD_RADIUS = 256;
 
     tilemap map;
-    std::vector<entity> ents;
+    std::unique_ptr<entity_storage> ents = std::make_unique<entity_storage>();
     std::string map_name = "Unnamed Zone";
     std::string map_subtitle = "caption me";
     std::string music_name;
@@ -315,6 +668,9 @@ struct world
     bool dark = false;
     uint32_t encounter_set_id = INVALID_ENCOUNTER;
     std::string battle_field_name = "";
+    foam_sites foam;
+    // in world pixels around the view
+    uint32_t lod_radius = DEFAULT_LOD_RADIUS;
 
     bool has_encounters() const
     {
@@ -325,12 +681,12 @@ struct world
     {
         assert(map.in_bounds(tile_x, tile_y));
 
-        entity& e = ents.emplace_back();
+        entity& e = ents->add();
         e.set_world_position(tile_to_world(tile_x), tile_to_world(tile_y));
-        e.type = npc;
+        e.set_type(npc);
         e.set_sprite_id(0);
 
-        player_index = ents.size() - 1;
+        player_index = ents->size() - 1;
 
         return player_index;
     }
@@ -338,24 +694,43 @@ struct world
     entity& player()
     {
         assert(player_index != INVALID_PLAYER_INDEX);
-        return ents[player_index];
+        return (*ents)[player_index];
     }
 
-    void update()
+    void despawn_player()
     {
-        for (entity& e : ents)
-        {
-            e.update();
-        }
+        assert(player_index != INVALID_PLAYER_INDEX);
+        ents->remove(player_index);
+        player_index = INVALID_PLAYER_INDEX;
+    }
+
+    // approximate heap footprint, used for cache accounting
+    size_t memory_usage() const
+    {
+        size_t bytes = sizeof(world) + map.memory_usage() + foam.memory_usage() + ents->memory_usage();
+        bytes += map_name.capacity() + map_subtitle.capacity() + music_name.capacity() + battle_field_name.capacity();
+        return bytes;
+    }
+
+    // view is in world pixels; entities further than lod_radius outside it animate at a reduced rate
+    void update(const rectangle& view)
+    {
+        const int r = static_cast<int>(lod_radius);
+        ents->update({view.x - r, view.y - r, view.w + 2 * r, view.h + 2 * r});
+    }
+
+    const activity_stats& activity() const
+    {
+        return ents->activity;
     }
 
     entity* find_entity(const std::string& name)
     {
-        for (size_t i = 0; i < ents.size(); ++i)
+        for (entity& e : *ents)
         {
-            if (ents[i].name == name)
+            if (e.name == name)
             {
-                return &ents[i];
+                return &e;
             }
         }
         return nullptr;
@@ -371,11 +746,11 @@ struct world
         uint32_t world_x = tile_to_world(tile_x);
         uint32_t world_y = tile_to_world(tile_y);
 
-        for (entity& e : ents)
+        for (size_t i = 0; i < ents->size(); ++i)
         {
-            if (e.world_x == world_x && e.world_y == world_y)
+            if (ents->world_x[i] == world_x && ents->world_y[i] == world_y)
             {
-                return &e;
+                return &(*ents)[i];
             }
         }
 
@@ -392,11 +767,11 @@ struct world
         uint32_t world_x = tile_to_world(tile_x);
         uint32_t world_y = tile_to_world(tile_y);
 
-        for (entity& e : ents)
+        for (size_t i = 0; i < ents->size(); ++i)
         {
-            if (e.type == et_portal && e.world_x == world_x && e.world_y == world_y)
+            if (ents->world_x[i] == world_x && ents->world_y[i] == world_y && (*ents)[i].get_type() == et_portal)
             {
-                return &e;
+                return &(*ents)[i];
             }
         }
 
@@ -517,7 +892,20 @@ inline variant read_variant(std::ifstream& input)
 
 #include "mathutil.hpp"
 
-inline world load_world(std::string_view filename)
+inline tile_layer read_layer_v1(std::ifstream& input, uint32_t width, uint32_t height)
+{
+    std::vector<tile> tiles(width * height);
+    input.read(reinterpret_cast<char*>(tiles.data()), tiles.size() * sizeof(tile));
+
+    // fixup IDs from tiled export
+    for (tile& x : tiles)
+        --x.id;
+
+    return tile_layer{std::move(tiles), width};
+}
+
+// legacy headerless format; kept so old map builds keep working
+inline world load_world_v1(std::string_view filename)
 {
     world wor;
     tilemap t;
@@ -526,22 +914,9 @@ inline world load_world(std::string_view filename)
     input.read(reinterpret_cast<char*>(&t.width), sizeof(t.width));
     input.read(reinterpret_cast<char*>(&t.height), sizeof(t.height));
 
-    const uint32_t size = t.width * t.height;
-    t.base.resize(size);
-    t.detail.resize(size);
-    t.fringe.resize(size);
-
-    input.read(reinterpret_cast<char*>(t.base.data()), t.base.size() * sizeof(tile));
-    input.read(reinterpret_cast<char*>(t.detail.data()), t.detail.size() * sizeof(tile));
-    input.read(reinterpret_cast<char*>(t.fringe.data()), t.fringe.size() * sizeof(tile));
-
-    // fixup IDs from tiled export
-    for (tile& x : t.base)
-        --x.id;
-    for (tile& x : t.detail)
-        --x.id;
-    for (tile& x : t.fringe)
-        --x.id;
+    t.base = read_layer_v1(input, t.width, t.height);
+    t.detail = read_layer_v1(input, t.width, t.height);
+    t.fringe = read_layer_v1(input, t.width, t.height);
 
     wor.map = std::move(t);
 
@@ -569,18 +944,18 @@ inline world load_world(std::string_view filename)
 
     for (const world_object& o : objs)
     {
-        entity& e = wor.ents.emplace_back();
+        entity& e = wor.ents->add();
         e.name = o.name;
         if (o.type == "npc")
-            e.type = npc;
+            e.set_type(npc);
         else if (o.type == "door")
-            e.type = door;
+            e.set_type(door);
         else if (o.type == "portal")
-            e.type = et_portal;
+            e.set_type(et_portal);
         else if (o.type == "light")
-            e.type = et_light;
+            e.set_type(et_light);
         else if (o.type == "switch")
-            e.type = et_switch;
+            e.set_type(et_switch);
         e.set_world_position(o.world_x, o.world_y);
         if (auto it = o.props.find("interact_id"); it != o.props.end())
         {
@@ -608,10 +983,10 @@ inline world load_world(std::string_view filename)
         }
         if (auto it = o.props.find("active"); it != o.props.end())
         {
-            e.active = (bool)std::get<uint32_t>(it->second);
+            e.set_active((bool)std::get<uint32_t>(it->second));
         }
-        assert(e.world_x % 16 == 0);
-        assert(e.world_y % 16 == 0);
+        assert(e.world_x() % 16 == 0);
+        assert(e.world_y() % 16 == 0);
     }
 
     uint32_t prop_count = read_u32(input);
@@ -661,3 +1036,195 @@ inline world load_world(std::string_view filename)
 
     return wor;
 }
+
+#include <cstring>
+#include <stdexcept>
+
+#include "map_format.hpp"
+#include "mapped_file.hpp"
+
+inline bool map_section_fits(const mapped_file& mf, uint64_t offset, uint64_t bytes)
+{
+    return offset % 4 == 0 && offset + bytes <= mf.size();
+}
+
+template <typename T>
+inline std::span<const T> map_section(const mapped_file& mf, uint32_t offset, uint64_t count)
+{
+    if (!map_section_fits(mf, offset, count * sizeof(T)))
+    {
+        throw std::runtime_error("load_world: map section out of range");
+    }
+    return {reinterpret_cast<const T*>(mf.data() + offset), static_cast<size_t>(count)};
+}
+
+inline tile_layer map_layer(const std::shared_ptr<const mapped_file>& mf, const map_file_header& header, const map_layer_record& layer)
+{
+    const uint64_t layer_size = static_cast<uint64_t>(header.width) * header.height;
+
+    switch (static_cast<tile_encoding>(layer.encoding))
+    {
+    case tile_encoding::raw32:
+        return tile_layer{map_section<tile>(*mf, layer.offset, layer_size), header.width, mf};
+    case tile_encoding::rle16:
+    {
+        if (header.width == 0 || header.width > UINT16_MAX + 1)
+        {
+            throw std::runtime_error("load_world: map too wide for rle16 layer");
+        }
+
+        auto row_starts = map_section<uint32_t>(*mf, layer.offset, header.height + 1ull);
+        auto runs = map_section<tile_run>(*mf, layer.offset + static_cast<uint32_t>(row_starts.size_bytes()), row_starts.back());
+
+        // validate once here so lookups can trust that every row covers exactly width columns
+        for (uint32_t y = 0; y < header.height; ++y)
+        {
+            if (row_starts[y] >= row_starts[y + 1] || row_starts[y + 1] > runs.size())
+            {
+                throw std::runtime_error("load_world: bad rle16 row");
+            }
+            uint32_t prev_x = 0;
+            for (uint32_t i = row_starts[y]; i < row_starts[y + 1]; ++i)
+            {
+                if ((i > row_starts[y] && runs[i].last_x <= prev_x) || runs[i].last_x >= header.width)
+                {
+                    throw std::runtime_error("load_world: bad rle16 run");
+                }
+                prev_x = runs[i].last_x;
+            }
+            if (prev_x != header.width - 1)
+            {
+                throw std::runtime_error("load_world: rle16 row does not cover the map");
+            }
+        }
+
+        return tile_layer{header.width, row_starts, runs, mf};
+    }
+    case tile_encoding::chunked16:
+    {
+        const uint64_t chunk_count = static_cast<uint64_t>((header.width + CHUNK_TILES - 1) / CHUNK_TILES) * ((header.height + CHUNK_TILES - 1) / CHUNK_TILES);
+        auto index = map_section<tile_chunk_entry>(*mf, layer.offset, chunk_count);
+        if (index.size_bytes() > layer.size)
+        {
+            throw std::runtime_error("load_world: chunk index out of range");
+        }
+        auto data = map_section<std::byte>(*mf, layer.offset + static_cast<uint32_t>(index.size_bytes()), layer.size - index.size_bytes());
+
+        // chunk contents are checked as they're decoded; only the index is checked up front so
+        // nothing but the index is touched at load
+        for (const tile_chunk_entry& entry : index)
+        {
+            if (entry.offset % 4 != 0 || entry.size < CHUNK_HEADER_SIZE || static_cast<uint64_t>(entry.offset) + entry.size > data.size())
+            {
+                throw std::runtime_error("load_world: bad chunk entry");
+            }
+        }
+
+        return tile_layer{header.width, header.height, index, data, mf};
+    }
+    default:
+        throw std::runtime_error("load_world: unknown layer encoding");
+    }
+}
+
+inline world load_world_v2(std::shared_ptr<const mapped_file> mf)
+{
+    world wor;
+
+    map_file_header header;
+    std::memcpy(&header, mf->data(), sizeof(header));
+
+    if (header.version != MAP_FILE_VERSION && header.version != MAP_FILE_VERSION_RAW_LAYERS)
+    {
+        throw std::runtime_error("load_world: unsupported map version");
+    }
+
+    auto string_entries = map_section<map_string_entry>(*mf, header.string_table_offset, header.string_count);
+    const uint64_t string_data_offset = header.string_table_offset + string_entries.size_bytes();
+    auto get_string = [&](uint32_t index) -> std::string_view {
+        if (index >= string_entries.size())
+        {
+            throw std::runtime_error("load_world: bad string index");
+        }
+        const map_string_entry& entry = string_entries[index];
+        if (string_data_offset + entry.offset + entry.length > mf->size())
+        {
+            throw std::runtime_error("load_world: string out of range");
+        }
+        return {reinterpret_cast<const char*>(mf->data() + string_data_offset + entry.offset), entry.length};
+    };
+
+    // tile layers are used in place; the layers keep the mapping alive
+    wor.map.width = header.width;
+    wor.map.height = header.height;
+    if (header.version == MAP_FILE_VERSION_RAW_LAYERS)
+    {
+        const uint64_t layer_size = static_cast<uint64_t>(header.width) * header.height;
+        auto layers = map_section<tile>(*mf, header.layers_offset, 3 * layer_size);
+        wor.map.base = tile_layer{layers.subspan(0 * layer_size, layer_size), header.width, mf};
+        wor.map.detail = tile_layer{layers.subspan(1 * layer_size, layer_size), header.width, mf};
+        wor.map.fringe = tile_layer{layers.subspan(2 * layer_size, layer_size), header.width, mf};
+    }
+    else
+    {
+        auto layers = map_section<map_layer_record>(*mf, header.layers_offset, 3);
+        wor.map.base = map_layer(mf, header, layers[0]);
+        wor.map.detail = map_layer(mf, header, layers[1]);
+        wor.map.fringe = map_layer(mf, header, layers[2]);
+    }
+
+    auto records = map_section<map_entity_record>(*mf, header.entities_offset, header.entity_count);
+    wor.ents->reserve(records.size() + 1);
+
+    for (const map_entity_record& r : records)
+    {
+        entity& e = wor.ents->add();
+        e.name = get_string(r.name);
+        e.set_type(static_cast<entity_type>(r.type));
+        e.set_world_position(r.world_x, r.world_y);
+        e.interact_script = r.interact_id;
+        if (r.sprite_id != MAP_NO_VALUE)
+        {
+            e.set_sprite_id(r.sprite_id);
+        }
+        e.portal_state.exit_map = get_string(r.exit_map);
+        e.portal_state.exit_name = get_string(r.exit_name);
+        e.light_state.light_radius = r.light_radius;
+        e.light_state.light_flicker_radius = r.light_flicker_radius;
+        e.set_active(r.active != 0);
+    }
+
+    const map_properties_record& props = map_section<map_properties_record>(*mf, header.properties_offset, 1)[0];
+    wor.map_name = get_string(props.map_name);
+    wor.map_subtitle = get_string(props.map_subtitle);
+    wor.music_name = get_string(props.music_name);
+    wor.battle_field_name = get_string(props.battle_field_name);
+    wor.water_direction_x = props.water_direction_x;
+    wor.water_direction_y = props.water_direction_y;
+    wor.water_drift_x = props.water_drift_x;
+    wor.water_drift_y = props.water_drift_y;
+    wor.water_speed = props.water_speed;
+    wor.dark = props.dark != 0;
+    wor.encounter_set_id = props.encounter_set_id;
+
+    return wor;
+}
+
+inline world load_world(std::string_view filename)
+{
+    std::shared_ptr<const mapped_file> mf = mapped_file::open(filename);
+    if (!mf)
+    {
+        throw std::runtime_error("load_world: could not open map file");
+    }
+
+    uint32_t magic = 0;
+    if (mf->size() >= sizeof(map_file_header))
+    {
+        std::memcpy(&magic, mf->data(), sizeof(magic));
+    }
+
+    world wor = magic == MAP_FILE_MAGIC ? load_world_v2(std::move(mf)) : load_world_v1(filename);
+    wor.foam = find_foam_sites(wor.map);
+    return wor;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "world.hpp"
+
+// Keeps recently left worlds around so that revisiting a map hands back the exact world the
+// player left (opened doors, flipped switches, lit torches) instead of reloading it from disk.
+// Worlds are evicted least recently used first once their accounted size exceeds the budget.
+class world_cache
+{
+public:
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+
+    explicit world_cache(size_t budget_bytes = DEFAULT_BUDGET)
+        : budget{budget_bytes}
+    {
+    }
+
+    size_t get_budget() const
+    {
+        return budget;
+    }
+
+    size_t bytes_used() const
+    {
+        return used;
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    bool contains(const std::string& name) const
+    {
+        return index.count(name);
+    }
+
+    // moves a cached world out of the cache
+    std::optional<world> take(const std::string& name)
+    {
+        auto it = index.find(name);
+        if (it == index.end())
+        {
+            return std::nullopt;
+        }
+
+        auto entry = it->second;
+        world wor = std::move(entry->wor);
+        used -= entry->bytes;
+        entries.erase(entry);
+        index.erase(it);
+        return wor;
+    }
+
+    // stores a world as the most recently used entry, replacing any older copy
+    void put(const std::string& name, world&& wor)
+    {
+        take(name);
+
+        cache_entry& entry = entries.emplace_front();
+        entry.name = name;
+        entry.bytes = wor.memory_usage();
+        entry.wor = std::move(wor);
+        used += entry.bytes;
+        index[name] = entries.begin();
+
+        evict();
+    }
+
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+        used = 0;
+    }
+
+private:
+    void evict()
+    {
+        while (used > budget && entries.size())
+        {
+            cache_entry& lru = entries.back();
+            used -= lru.bytes;
+            index.erase(lru.name);
+            entries.pop_back();
+        }
+    }
+
+    struct cache_entry
+    {
+        std::string name;
+        world wor;
+        size_t bytes = 0;
+    };
+
+    // front is the most recently used
+    std::list<cache_entry> entries;
+    std::unordered_map<std::string, std::list<cache_entry>::iterator> index;
+    size_t budget;
+    size_t used = 0;
+};
@@ -0,0 +1,414 @@
+// Runs many headless battles of one encounter across every core and reports how they went: win
+// rate, time to kill, damage taken and how fast the simulation ran. Battle n is seeded with the
+// base seed plus n, so any single battle can be replayed on its own.
+//
+//   battle_sim [options]
+//     --set N --encounter I   encounter I of encounter set N (default 0 0)
+//     --enemies a,b,...       a lineup by name instead: slime skeleton bat ghost spider ragworm
+//     --horde N               N enemies taking turns from the encounter or lineup, spread out
+//     --runs N                battles to simulate (default 2000)
+//     --threads N             worker threads (default: one per core)
+//     --policy kite|random    how the player plays (default kite)
+//     --level N               player level (default 1)
+//     --unlock                give the player flash jump, avenger and the shadow partner
+//     --seed S                base seed (default 1)
+//     --width W               width of the battlefield (default 480)
+//     --timeout S             seconds after which a battle counts as a draw (default 300)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <print>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "battle/battle_field.hpp"
+#include "battle/encounters.hpp"
+#include "battle/player_kit.hpp"
+#include "gamestate.hpp"
+#include "random.hpp"
+
+// game.cpp's UPDATE_RATE
+constexpr uint32_t TICKS_PER_SECOND = 30;
+
+enum player_policy
+{
+    pp_kite,
+    pp_random,
+};
+
+struct sim_options
+{
+    encounter enc = get_encounter_set(0).encounters[0];
+    uint32_t runs = 2000;
+    uint32_t threads = 0;
+    player_policy policy = pp_kite;
+    int32_t level = 1;
+    bool unlock = false;
+    uint64_t seed = 1;
+    float width = 480;
+    uint32_t timeout_seconds = 300;
+};
+
+enum battle_outcome
+{
+    bo_won,
+    bo_lost,
+    bo_timeout,
+};
+
+struct battle_record
+{
+    battle_outcome outcome;
+    uint32_t ticks;
+    int32_t damage_taken;
+};
+
+struct player_input
+{
+    int move = 0;
+    bool jump = false;
+    bool throw_knives = false;
+    bool throw_avenger = false;
+};
+
+// keeps the nearest enemy at throwing range, facing it, and jumps over whatever gets close
+static player_input kite(const battle_field& field, const player_kit& kit)
+{
+    player_input in;
+    const battle_character& player = field.characters[field.player_index];
+
+    const battle_character* target = nullptr;
+    float target_dist = INFINITY;
+    for (const battle_character& c : field.characters)
+    {
+        if (&c != &player && c.alive && std::abs(c.pos.x - player.pos.x) < target_dist)
+        {
+            target = &c;
+            target_dist = std::abs(c.pos.x - player.pos.x);
+        }
+    }
+    if (!target)
+    {
+        return in;
+    }
+
+    const int toward = target->pos.x < player.pos.x ? -1 : 1;
+    const direction toward_dir = toward < 0 ? left : right;
+    const bool at_wall = (toward > 0 && player.pos.x <= field.bounds.left + 1) || (toward < 0 && player.pos.x >= field.bounds.right - 1);
+
+    if (target_dist < 40 && !at_wall)
+    {
+        in.move = -toward;
+    }
+    else if (target_dist > 140 || player.facing != toward_dir)
+    {
+        in.move = toward;
+    }
+
+    in.jump = target_dist < 24;
+    for (const battle_projectile& p : field.projectiles)
+    {
+        const bool incoming = (p.pos.x < player.pos.x) == (p.vel.x > 0);
+        if (p.owner.index != field.player_index && incoming && std::abs(p.pos.x - player.pos.x) < 32 && std::abs(p.pos.y - player.pos.y) < 24)
+        {
+            in.jump = true;
+            break;
+        }
+    }
+
+    if (player.facing == toward_dir)
+    {
+        in.throw_avenger = kit.has_avenger && target_dist > 96;
+        in.throw_knives = !in.throw_avenger;
+    }
+    return in;
+}
+
+// mashes buttons, holding each direction for a while
+struct random_player
+{
+    int move = 0;
+    uint32_t hold = 0;
+
+    player_input decide(rng_stream& rng)
+    {
+        if (hold == 0)
+        {
+            move = rng.rand_int(-1, 1);
+            hold = rng.rand_int(5, 30);
+        }
+        --hold;
+
+        player_input in;
+        in.move = move;
+        in.jump = rng.chance(0.03f);
+        in.throw_knives = rng.chance(0.1f);
+        in.throw_avenger = rng.chance(0.02f);
+        return in;
+    }
+};
+
+// the same steps in the same order as st_battle::update after the fade in
+static battle_record simulate(battle_field& field, const sim_options& opt, uint64_t seed)
+{
+    const battle_field_bounds bounds{-opt.width / 2, opt.width / 2, 0};
+    field.begin(opt.enc, bounds, seed);
+
+    player_stats stats;
+    stats.level = opt.level;
+    field.player().life = stats.max_life();
+    field.player().power = stats.power();
+
+    player_kit kit;
+    kit.has_flashjump = kit.has_avenger = kit.has_shadowpartner = opt.unlock;
+
+    // its own stream, so how the player plays doesn't change what the enemies roll
+    rng_stream policy_rng{~seed};
+    random_player random_policy;
+
+    const uint32_t max_ticks = opt.timeout_seconds * TICKS_PER_SECOND;
+    for (uint32_t tick = 1; tick <= max_ticks; ++tick)
+    {
+        player_input in;
+        if (field.player().can_act())
+        {
+            in = opt.policy == pp_kite ? kite(field, kit) : random_policy.decide(policy_rng);
+            if (in.jump)
+            {
+                kit.jump(field);
+            }
+            if (in.throw_knives)
+            {
+                kit.throw_knives(field);
+            }
+            if (in.throw_avenger)
+            {
+                kit.throw_avenger(field);
+            }
+        }
+
+        field.update(false);
+
+        if (field.player().can_act())
+        {
+            if (in.move < 0)
+            {
+                field.player().move_left();
+            }
+            else if (in.move > 0)
+            {
+                field.player().move_right();
+            }
+        }
+
+        kit.update(field);
+
+        const int32_t damage = stats.max_life() - std::max(field.player().life, 0);
+        if (!field.hostiles_alive())
+        {
+            return {bo_won, tick, damage};
+        }
+        if (!field.player().alive)
+        {
+            return {bo_lost, tick, damage};
+        }
+    }
+    return {bo_timeout, max_ticks, stats.max_life() - std::max(field.player().life, 0)};
+}
+
+constexpr std::pair<std::string_view, battle_character_info_id> ENEMY_NAMES[]{
+    {"slime", BCI_SLIME},
+    {"skeleton", BCI_SKELETON},
+    {"bat", BCI_BAT},
+    {"ghost", BCI_GHOST},
+    {"spider", BCI_SPIDER},
+    {"ragworm", BCI_RAGWORM},
+};
+
+static std::string_view enemy_name(battle_character_info_id id)
+{
+    for (const auto& [name, name_id] : ENEMY_NAMES)
+    {
+        if (name_id == id)
+        {
+            return name;
+        }
+    }
+    return "?";
+}
+
+static bool parse_enemies(std::string_view list, encounter& enc)
+{
+    std::fill(std::begin(enc.enemies), std::end(enc.enemies), BCI_NULL);
+    size_t count = 0;
+    while (!list.empty())
+    {
+        const size_t comma = list.find(',');
+        const std::string_view name = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+
+        auto it = std::find_if(std::begin(ENEMY_NAMES), std::end(ENEMY_NAMES), [&](const auto& n) { return n.first == name; });
+        if (it == std::end(ENEMY_NAMES) || count == std::size(enc.enemies))
+        {
+            return false;
+        }
+        enc.enemies[count++] = it->second;
+    }
+    return count > 0;
+}
+
+static bool parse_options(int argc, char* argv[], sim_options& opt)
+{
+    uint32_t set = 0, index = 0, horde_size = 0;
+    bool lineup = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--unlock")
+        {
+            opt.unlock = true;
+            continue;
+        }
+        if (i + 1 == argc)
+        {
+            return false;
+        }
+
+        const char* value = argv[++i];
+        if (arg == "--set")
+            set = std::strtoul(value, nullptr, 10);
+        else if (arg == "--encounter")
+            index = std::strtoul(value, nullptr, 10);
+        else if (arg == "--enemies")
+        {
+            if (!parse_enemies(value, opt.enc))
+                return false;
+            lineup = true;
+        }
+        else if (arg == "--horde")
+            horde_size = std::strtoul(value, nullptr, 10);
+        else if (arg == "--runs")
+            opt.runs = std::strtoul(value, nullptr, 10);
+        else if (arg == "--threads")
+            opt.threads = std::strtoul(value, nullptr, 10);
+        else if (arg == "--policy")
+        {
+            if (std::string_view{value} == "kite")
+                opt.policy = pp_kite;
+            else if (std::string_view{value} == "random")
+                opt.policy = pp_random;
+            else
+                return false;
+        }
+        else if (arg == "--level")
+            opt.level = std::max(1, std::atoi(value));
+        else if (arg == "--seed")
+            opt.seed = std::strtoull(value, nullptr, 10);
+        else if (arg == "--width")
+            opt.width = std::max(64.0f, std::strtof(value, nullptr));
+        else if (arg == "--timeout")
+            opt.timeout_seconds = std::strtoul(value, nullptr, 10);
+        else
+            return false;
+    }
+
+    if (!lineup)
+    {
+        if (set > 2 || index >= get_encounter_set(set).encounters.size())
+        {
+            return false;
+        }
+        opt.enc = get_encounter_set(set).encounters[index];
+    }
+    opt.enc.horde_size = horde_size;
+    return opt.runs > 0;
+}
+
+static double percentile(std::vector<uint32_t>& sorted_ticks, double p)
+{
+    if (sorted_ticks.empty())
+    {
+        return 0;
+    }
+    const size_t i = std::min(sorted_ticks.size() - 1, static_cast<size_t>(p * sorted_ticks.size()));
+    return sorted_ticks[i] / static_cast<double>(TICKS_PER_SECOND);
+}
+
+int main(int argc, char* argv[])
+{
+    sim_options opt;
+    if (!parse_options(argc, argv, opt))
+    {
+        std::println(stderr, "usage: battle_sim [--set N --encounter I | --enemies a,b,...] [--horde N] [--runs N] [--threads N]");
+        std::println(stderr, "                  [--policy kite|random] [--level N] [--unlock] [--seed S] [--width W] [--timeout S]");
+        return 1;
+    }
+
+    const uint32_t threads = opt.threads ? opt.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<battle_record> records(opt.runs);
+    std::atomic<uint32_t> next_run = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (uint32_t t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&] {
+            // each worker reuses one field; its pools are reserved up front
+            auto field = std::make_unique<battle_field>();
+            for (uint32_t run = next_run++; run < opt.runs; run = next_run++)
+            {
+                records[run] = simulate(*field, opt, opt.seed + run);
+            }
+        });
+    }
+    for (std::thread& w : workers)
+    {
+        w.join();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint32_t wins = 0, losses = 0, timeouts = 0;
+    uint64_t total_ticks = 0;
+    int64_t total_damage = 0;
+    int32_t max_damage = 0;
+    std::vector<uint32_t> win_ticks;
+    for (const battle_record& r : records)
+    {
+        wins += r.outcome == bo_won;
+        losses += r.outcome == bo_lost;
+        timeouts += r.outcome == bo_timeout;
+        total_ticks += r.ticks;
+        total_damage += r.damage_taken;
+        max_damage = std::max(max_damage, r.damage_taken);
+        if (r.outcome == bo_won)
+        {
+            win_ticks.push_back(r.ticks);
+        }
+    }
+    std::sort(win_ticks.begin(), win_ticks.end());
+
+    std::print("encounter:");
+    for (battle_character_info_id id : opt.enc.enemies)
+    {
+        if (id != BCI_NULL)
+        {
+            std::print(" {}", enemy_name(id));
+        }
+    }
+    if (opt.enc.horde_size)
+    {
+        std::print(", a horde of {}", opt.enc.horde_size);
+    }
+    std::println("  ({} runs, {} policy, level {}{}, seed {})", opt.runs, opt.policy == pp_kite ? "kite" : "random", opt.level, opt.unlock ? ", all skills" : "", opt.seed);
+    std::println("won {:.1f}%  lost {:.1f}%  timed out {:.1f}%", 100.0 * wins / opt.runs, 100.0 * losses / opt.runs, 100.0 * timeouts / opt.runs);
+    std::println("time to kill: p50 {:.1f}s  p90 {:.1f}s  max {:.1f}s", percentile(win_ticks, 0.5), percentile(win_ticks, 0.9), percentile(win_ticks, 1.0));
+    std::println("damage taken: mean {:.2f}  max {}", static_cast<double>(total_damage) / opt.runs, max_damage);
+    std::println("{} ticks in {:.2f}s on {} threads: {:.0f} ticks/s", total_ticks, seconds, threads, total_ticks / seconds);
+}